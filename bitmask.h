@@ -0,0 +1,82 @@
+/* Bit-packed masks: one bit per voxel, for volumes which only say whether a
+ * voxel is in or out.  Every scanline is packed into whole 64 bit words,
+ * voxel x in bit x%64 of word x/64; the bits past the end of a scanline are
+ * zero.  Scanlines follow each other (y, then z) without any further
+ * padding, in host byte order.  The nhdr says "type: bit".
+ *
+ * Since scanlines start at word boundaries, runs of voxels and the overlap
+ * of neighboring scanlines are found a word, i.e. 64 voxels, at a time. */
+#ifndef TJF_BITMASK_H
+#define TJF_BITMASK_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
+/// words per scanline of 'nx' voxels.
+inline uint64_t mask_words(uint64_t nx) { return (nx + 63) / 64; }
+
+/// bytes in a mask of size 'dims'.
+inline uint64_t mask_bytes(const std::array<uint64_t,3>& dims) {
+  return mask_words(dims[0])*dims[1]*dims[2]*sizeof(uint64_t);
+}
+
+/// packs the scanline 'in' of 'n' voxels, nonzero meaning set.
+inline void pack_row(const uint8_t* in, uint64_t n, uint64_t* out) {
+  const uint64_t words = mask_words(n);
+  for(uint64_t w=0; w < words; ++w) {
+    const uint64_t b = w*64, e = std::min(n, b+64);
+    uint64_t word = 0;
+#ifdef __SSE2__
+    if(e - b == 64) { // a byte compare, and the sign bits, 16 at a time.
+      const __m128i zero = _mm_setzero_si128();
+      for(unsigned i=0; i < 4; ++i) {
+        const __m128i v = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(in + b + 16*i)
+        );
+        const unsigned unset = _mm_movemask_epi8(_mm_cmpeq_epi8(v, zero));
+        word |= uint64_t(~unset & 0xffffu) << (16*i);
+      }
+      out[w] = word;
+      continue;
+    }
+#endif
+    for(uint64_t x=b; x < e; ++x) { word |= uint64_t(in[x] != 0) << (x-b); }
+    out[w] = word;
+  }
+}
+
+/// unpacks the scanline 'in' into 'n' voxels of 0 or 1.
+inline void unpack_row(const uint64_t* in, uint64_t n, uint8_t* out) {
+  for(uint64_t x=0; x < n; ++x) { out[x] = (in[x/64] >> (x%64)) & 1; }
+}
+
+/// calls f(a, b) for every maximal run [a,b) of set bits within [x0,x1) of
+/// a scanline, whose words 'word(w)' gives.  'word' may combine scanlines,
+/// e.g. to find where two overlap.
+template<typename W, typename F>
+void bit_runs(W word, uint64_t x0, uint64_t x1, F f) {
+  uint64_t x = x0;
+  while(x < x1) {
+    // the next set bit...
+    uint64_t w = x/64;
+    uint64_t bits = word(w) & (~uint64_t(0) << (x%64));
+    while(bits == 0) {
+      if(++w*64 >= x1) { return; }
+      bits = word(w);
+    }
+    const uint64_t a = w*64 + __builtin_ctzll(bits);
+    if(a >= x1) { return; }
+    // ... and the next clear one.
+    bits = ~word(w) & (~uint64_t(0) << (a%64));
+    while(bits == 0 && ++w*64 < x1) { bits = ~word(w); }
+    const uint64_t b = bits ? std::min(x1, w*64 + __builtin_ctzll(bits)) : x1;
+    f(a, b);
+    x = b;
+  }
+}
+
+#endif /* TJF_BITMASK_H */
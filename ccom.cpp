@@ -1,242 +1,1271 @@
 #include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <fcntl.h>
+#include <fstream>
+#include <functional>
+#include <iomanip>
 #include <iostream>
-#include <omp.h>
-#include <set>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <sstream>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
 #include "ccom.h"
 
+#include "bitmask.h"
+#include "component-index.h"
 #include "config.h"
 #include "disjointset.h"
 #include "f-nrrd.h"
+#include "histogram.h"
 #include "mmap-memory.h"
+#include "runs.h"
+#include "slab.h"
+#include "tasks.h"
+#include "tiff-stack.h"
+#include "volume.h"
+#include "volume-cache.h"
+
+namespace {
+  // a set of input values from the config: [lo,hi), or just 'lo' if 'point'.
+  struct interval {
+    double lo, hi;
+    bool point;
+  };
+}
 
 // identifies the set of equivalences which should be considered equal
 // expects to parse something of the form:
 //    { range a b }
 // or:
 //    { a b c }
-// The former means the values 'a' through 'b' are the same.
+// The former means the values 'a' through 'b' (exclusive) are the same.
 // The latter means that a, b, and c should all be considered the same value
-static std::set<int64_t> equivalences(std::istream& is)
+// Any of the values may also be an automatic bound such as auto:otsu.
+static std::vector<interval> equivalences(std::istream& is,
+                                          auto_bounds& resolve)
 {
   std::string junk;
   std::string value;
 
-  std::set<int64_t> equiv;
+  auto number = [&](std::string v) {
+    double n;
+    std::istringstream c(resolve(v));
+    if(!(c >> n)) { throw std::invalid_argument("bad value '" + v + "'"); }
+    return n;
+  };
+
+  std::vector<interval> equiv;
   is >> junk; // leading "{"
   is >> value;
   if(value == "range") { //  parse range values
-    int64_t lower, upper;
+    std::string lower, upper;
     is >> lower >> upper;
-    for(int64_t i=lower; i < upper; ++i) {
-      equiv.insert(i);
-    }
-  } else { // parse out set
-    int64_t v;
-    // 'value' is an actual value.. convert it to an integer and add it.
-    std::istringstream c(value);
-    c >> v;
-    equiv.insert(v);
-    // now convert all the rest of the values
-    while(is) {
-      is >> v;
-      if(is) {
-        equiv.insert(v);
-      }
+    const interval iv = { number(lower), number(upper), false };
+    equiv.push_back(iv);
+    is >> junk; // trailing "}"
+  } else { // parse out set, up to the trailing "}"
+    while(is && value != "}") {
+      const double v = number(value);
+      const interval iv = { v, v, true };
+      equiv.push_back(iv);
+      is >> value;
     }
   }
-  is >> junk; // trailing "}"
   return equiv;
 }
 
+namespace {
+  // converts, saturating at the limits of T.
+  template<typename T> T saturate(double v) {
+    if(v <= double(std::numeric_limits<T>::lowest())) {
+      return std::numeric_limits<T>::lowest();
+    }
+    if(v >= double(std::numeric_limits<T>::max())) {
+      return std::numeric_limits<T>::max();
+    }
+    return static_cast<T>(v);
+  }
+
+  // the intervals as (disjoint) bands of the input type, of class 'id'.
+  // integers in a range go up to hi-1; floating point values up to just
+  // below hi.
+  template<typename T> std::vector<band<T>> bands_of(
+    const std::vector<interval>& ivs, uint8_t id=1)
+  {
+    const bool integer = std::numeric_limits<T>::is_integer;
+    std::vector<std::pair<T,T>> in;
+    for(const interval& iv : ivs) {
+      if(integer && iv.point && iv.lo != std::floor(iv.lo)) { continue; }
+      if(iv.point) {
+        const T v = saturate<T>(iv.lo);
+        in.push_back(std::make_pair(v, v));
+        continue;
+      }
+      if(!(iv.lo < iv.hi)) { continue; }
+      const T lo = saturate<T>(integer ? std::ceil(iv.lo) : iv.lo);
+      T hi = saturate<T>(integer ? std::ceil(iv.hi) - 1 : iv.hi);
+      if(!integer && double(hi) >= iv.hi) {
+        hi = std::nextafter(hi, std::numeric_limits<T>::lowest());
+      }
+      if(lo <= hi) { in.push_back(std::make_pair(lo, hi)); }
+    }
+    // classifier bands may not overlap, so merge them.
+    std::sort(in.begin(), in.end());
+    std::vector<band<T>> bands;
+    for(const auto& r : in) {
+      if(!bands.empty() &&
+         (r.first <= bands.back().hi ||
+          (integer && double(r.first) == double(bands.back().hi) + 1))) {
+        bands.back().hi = std::max(bands.back().hi, r.second);
+        continue;
+      }
+      const band<T> b = { r.first, r.second, id };
+      bands.push_back(b);
+    }
+    return bands;
+  }
+
+  // the bands of every class; class k gets id k+1.  a value may only belong
+  // to one class.
+  template<typename T> std::vector<band<T>> bands_of(
+    const std::vector<std::vector<interval>>& classes)
+  {
+    if(classes.size() > std::numeric_limits<uint8_t>::max()) {
+      throw std::invalid_argument("at most 255 component classes");
+    }
+    std::vector<band<T>> bands;
+    for(size_t k=0; k < classes.size(); ++k) {
+      const std::vector<band<T>> b = bands_of<T>(classes[k], uint8_t(k+1));
+      bands.insert(bands.end(), b.begin(), b.end());
+    }
+    std::sort(bands.begin(), bands.end(),
+              [](const band<T>& a, const band<T>& b) { return a.lo < b.lo; });
+    for(size_t i=1; i < bands.size(); ++i) {
+      if(bands[i].lo <= bands[i-1].hi) {
+        throw std::invalid_argument("component classes overlap");
+      }
+    }
+    return bands;
+  }
+
+  // where label() keeps its provisional labels: all of them, in the output
+  // volume (which starts at slice z0).
+  template<typename L> struct dense_rows {
+    typedef L label_type;
+    dense_rows(L* l, const std::array<uint64_t,3>& dims, uint64_t z) :
+      labels(l), width(dims[0]), slice(dims[0]*dims[1]), z0(z) {}
+    L* row(uint64_t z, uint64_t y) {
+      return this->labels + (z-this->z0)*this->slice + y*this->width;
+    }
+    void done(const L*) {}
+
+    L* labels;
+    uint64_t width, slice, z0;
+  };
+
+  // ... or just the last two slices, while the runs of every finished
+  // scanline go to 'out'.  provisional labels are then only limited by the
+  // width of a run's label.
+  struct run_rows {
+    typedef uint64_t label_type;
+    run_rows(run_volume& v, const std::array<uint64_t,3>& dims, uint64_t z) :
+      out(v), ring(2*dims[0]*dims[1]), width(dims[0]),
+      slice(dims[0]*dims[1]), z0(z) {}
+    uint64_t* row(uint64_t z, uint64_t y) {
+      return this->ring.data() + ((z-this->z0)&1)*this->slice + y*this->width;
+    }
+    void done(const uint64_t* scanline) { this->out.append(scanline); }
+
+    run_volume& out;
+    std::vector<uint64_t> ring;
+    uint64_t width, slice, z0;
+  };
+
+  // the next provisional label.
+  template<typename L> L fresh(uint64_t& next) {
+    if(next > std::numeric_limits<L>::max()) {
+      throw std::overflow_error("too many provisional labels for the output "
+                                "type; use a wider 'outtype'");
+    }
+    return static_cast<L>(next++);
+  }
+
+  // throws unless the final labels 1..'components' fit into 'bytes' wide
+  // labels.  each slab counts its provisional labels from 1, so fresh()
+  // alone does not see a merge overflow.
+  void check_labels(uint64_t components, size_t bytes) {
+    if(bytes < sizeof(uint64_t) && components >> 8*bytes != 0) {
+      throw std::overflow_error("too many components for the output type; "
+                                "use a wider 'outtype'");
+    }
+  }
 
-void ccom(const char* fn_config) {
-  config cfg(fn_config);
-
-  nrrd innhdr(cfg.value("in").c_str());
-  assert(innhdr.n_dimensions() == 3); // can't handle more, right now.
-  const std::array<uint64_t,3> dims = innhdr.dimensions();
-
-  // for now, we can only deal with 8bit data!
-  // this is because it's a PITA otherwise: what type does this function
-  // return?  it should return the type of the nrrd we are reading from.
-  // but that means we need to templatize it.  templatized lambdas don't
-  // exist.
-  assert(innhdr.datatype() == nrrd::UINT8);
-
-  const uint64_t bytes = std::accumulate(dims.begin(), dims.end(),
-                                         sizeof(uint8_t),
-                                         std::multiplies<uint64_t>());
-  std::ifstream in(innhdr.filename().c_str(), std::ios::binary | std::ios::in);
-  std::istringstream iss(cfg.value("component"));
-  const std::set<int64_t> equivs = equivalences(iss);
-
-  std::clog << "Creating '" << cfg.value("outraw") << "' output file.\n";
-  memory out(cfg.value("outraw").c_str(), bytes);
-  uint8_t* labels = static_cast<uint8_t*>(out.map);
-  std::clog << "Zeroing out map...\n";
-  std::fill(labels, labels+bytes, 0);
-
-
-  // CURRENT ISSUE:
-  // what are the semantics for values in/out of the range?
-  // if we have a 1D DS of: 42 42 42 19 19 19 and the range is given as 0
-  // through 20.. we want the result to be 0 0 0 1 1 1.  So I guess that means
-  // we should just *first* check whether a value is in the range, and if not
-  // then set it to 0 and move on.  But then the case: 19 19 19 42 42 42
-  // would end up as all zeroes, as the first identifier is 0.  So I guess we
-  // should just start the identifiers at 1, then.
-
-  auto valid_coordinate = [=](std::array<int64_t,3> d) {
-    std::array<int64_t,3> ds;
-    std::copy(dims.begin(), dims.end(), ds.begin());
-    assert(std::accumulate(ds.begin(), ds.end(), 0, std::plus<int64_t>()) > 0);
-    return 0 <= d[0] && d[0] < ds[0] &&
-           0 <= d[1] && d[1] < ds[1] &&
-           0 <= d[2] && d[2] < ds[2];
-  };
-  auto idx = [&](std::array<int64_t,3> d) {
-    assert(valid_coordinate(d));
-    return d[2]*(dims[0]*dims[1]) + d[1]*(dims[0]) + d[0];
-  };
-  auto value = [&](std::array<int64_t,3> d) {
-    in.seekg(idx(d));
-    uint8_t v;
-    in.read(reinterpret_cast<char*>(&v), sizeof(uint8_t));
-    /// @todo once we support multi-byte data, we probably want to do
-    /// endianness conversion here.
-    return v;
-  };
-  // true if the values at these two locations are the same, via the definition
-  // of equality given in the config file.
-  auto equal = [&](std::array<int64_t,3> a, std::array<int64_t,3> b) {
-    return equivs.count(value(a)) > 0 && equivs.count(value(b)) > 0;
-  };
-  // true iff equal AND the coordinates are valid.
-  // "c"equal -- "coordinate" equal
-  auto cequal = [&](std::array<int64_t,3> a, std::array<int64_t,3> b) {
-    assert(valid_coordinate(a) || valid_coordinate(b));
-    if(!valid_coordinate(a)) { return false; }
-    if(!valid_coordinate(b)) { return false; }
-    return equal(a,b);
-  };
-
-  DisjointSet ds;
-
-  uint8_t identifier = 1;
-  std::clog << "Pass 1...\n";
-  #pragma omp parallel for
-  for(uint64_t z=0; z < dims[2]; ++z) {
+  // copies slice 'z' of 'rows' into 'face'.
+  template<typename Rows>
+  void copy_face(Rows& rows, const std::array<uint64_t,3>& dims, uint64_t z,
+                 std::vector<uint64_t>& face) {
+    face.resize(dims[0]*dims[1]);
     for(uint64_t y=0; y < dims[1]; ++y) {
-      for(uint64_t x=0; x < dims[0]; ++x) {
-#if 1
-        if(idx({{x,y,z}}) % 1000 == 0 && omp_get_thread_num() == 0) {
-          auto cur = idx({{x,y,z}});
-          auto last = idx({{dims[0]-1, dims[1]-1, dims[2]-1}}) /
-                      omp_get_num_threads();
-          std::clog << "\r" << cur << " / " << last << " ("
-                    << static_cast<double>(cur) / last * 100.0 << "%)...";
-        }
-#endif
-        // our function may decide this is background.
-        if(equivs.count(value({{x,y,z}})) == 0) {
-          labels[idx({{x,y,z}})] = 0;
-          continue;
-        }
+      std::copy(rows.row(z, y), rows.row(z, y)+dims[0],
+                face.begin() + y*dims[0]);
+    }
+  }
 
-        // is this voxel the one to merge all 3 neighbors?
-        if(cequal({{x-1,y,z}}, {{x,y,z}}) && cequal({{x,y-1,z}}, {{x,y,z}}) &&
-           cequal({{x,y,z-1}}, {{x,y,z}})) {
-          // just copy left label; they'll all be unioned anyway, so it won't
-          // matter, we'll clean it up in the second pass.
-          labels[idx({{x,y,z}})] = labels[idx({{x-1,y,z}})];
-          // (left equiv above) and (above equiv behind) and (left equiv this)
-          ds.unio(labels[idx({{x-1,y,z}})], labels[idx({{x,y-1,z}})]);
-          ds.unio(labels[idx({{x,y-1,z}})], labels[idx({{x,y,z-1}})]);
-          ds.unio(labels[idx({{x-1,y,z}})], labels[idx({{x,y,z}})]);
-          continue;
-        }
+  // finds the roots of the provisional labels [1,next), and puts them on
+  // the faces.
+  void resolve(slab& s, DisjointSet& ds, uint64_t next) {
+    s.roots.resize(next);
+    for(uint64_t p=1; p < next; ++p) { s.roots[p] = ds.find(p); }
+    for(uint64_t i=0; i < s.top.size(); ++i) {
+      s.top[i] = s.roots[s.top[i]];
+      s.bottom[i] = s.roots[s.bottom[i]];
+    }
+  }
 
-        // merge any two neighbors?  z-1&y-1, z-1&x-1, y-1&x-1
-        // z-1&y-1
-        if(cequal({{x,y,z-1}}, {{x,y,z}}) && cequal({{x,y-1,z}}, {{x,y,z}})) {
-          labels[idx({{x,y,z}})] = labels[idx({{x,y,z-1}})];
-          ds.unio(labels[idx({{x,y,z-1}})], labels[idx({{x,y-1,z}})]);
-          ds.unio(labels[idx({{x,y,z-1}})], labels[idx({{x,y,z}})]);
-          continue;
-        }
-        // z-1&x-1
-        if(cequal({{x,y,z-1}}, {{x,y,z}}) && cequal({{x-1,y,z}}, {{x,y,z}})) {
-          labels[idx({{x,y,z}})] = labels[idx({{x,y,z-1}})];
-          ds.unio(labels[idx({{x,y,z-1}})], labels[idx({{x-1,y,z}})]);
-          ds.unio(labels[idx({{x,y,z-1}})], labels[idx({{x,y,z}})]);
-          continue;
+  // labels slices [z0,z1) of a volume, writing provisional labels into
+  // 'rows'.  'in' points at slice z0.
+  // neighbors outside the slab are not considered; that is what the faces we
+  // return are for.  voxels only connect to neighbors of the same class.
+  template<typename T, typename Rows>
+  slab label(const T* in, const std::array<uint64_t,3>& dims,
+             const std::array<uint64_t,3>& strides, const classifier<T>& cls,
+             uint64_t z0, uint64_t z1, Rows& rows)
+  {
+    typedef typename Rows::label_type L;
+    slab s;
+    s.z0 = z0;
+    s.z1 = z1;
+    s.roots.assign(1, 0);
+    s.classes.assign(1, 0);
+    if(z0 == z1) { return s; }
+
+    std::vector<T> row(strides[0] == 1 ? 0 : dims[0]);
+    std::vector<uint8_t> member(dims[0]);
+
+    // what are the semantics for values in/out of the range?
+    // if we have a 1D DS of: 42 42 42 19 19 19 and the range is given as 0
+    // through 20.. we want the result to be 0 0 0 1 1 1.  So we *first*
+    // check whether a value is in the range, and if not set it to 0 and move
+    // on.  0 is thus a known separator, and identifiers start at 1.
+    DisjointSet ds;
+    uint64_t next = 1;
+    for(uint64_t z=z0; z < z1; ++z) {
+      for(uint64_t y=0; y < dims[1]; ++y) {
+        const T* src = in + (z-z0)*strides[2] + y*strides[1];
+        if(strides[0] != 1) {
+          for(uint64_t x=0; x < dims[0]; ++x) { row[x] = src[x*strides[0]]; }
+          src = row.data();
         }
-        // y-1&x-1
-        if(cequal({{x,y-1,z}}, {{x,y,z}}) && cequal({{x-1,y,z}}, {{x,y,z}})) {
-          labels[idx({{x,y,z}})] = labels[idx({{x,y-1,z}})];
-          ds.unio(labels[idx({{x,y-1,z}})], labels[idx({{x-1,y,z}})]);
-          ds.unio(labels[idx({{x,y-1,z}})], labels[idx({{x,y,z}})]);
-          continue;
+        cls(src, member.data(), dims[0]);
+
+        L* cur = rows.row(z, y);
+        const L* prev = z > z0 ? rows.row(z-1, y) : NULL;
+        for(uint64_t x=0; x < dims[0]; ++x) {
+          const uint8_t c = member[x];
+          if(!c) {
+            cur[x] = 0;
+            continue;
+          }
+          // only voxels in a class get nonzero labels, so a nonzero
+          // neighbor of our class is one we are connected to.
+          const L left = x > 0 && member[x-1] == c ? cur[x-1] : 0;
+          L below = y > 0 ? cur[x-dims[0]] : 0;
+          if(below && s.classes[below] != c) { below = 0; }
+          L behind = prev ? prev[x] : 0;
+          if(behind && s.classes[behind] != c) { behind = 0; }
+          L lbl = left ? left : below ? below : behind;
+          if(lbl == 0) { // merges nobody, then!  assign a new label.
+            lbl = fresh<L>(next);
+            s.classes.push_back(c);
+          }
+          if(below && below != lbl) { ds.unio(lbl, below); }
+          if(behind && behind != lbl) { ds.unio(lbl, behind); }
+          cur[x] = lbl;
         }
+        rows.done(cur);
+      }
+      // rows may not keep this slice around.
+      if(z == z0) { copy_face(rows, dims, z, s.top); }
+    }
+    copy_face(rows, dims, z1-1, s.bottom);
+    resolve(s, ds, next);
+    return s;
+  }
+
+  // the same for a bit-packed mask (see bitmask.h), a run of voxels at a
+  // time: a run takes the label of the first run it overlaps in the
+  // scanline below or behind it, and unites it with the others.  labels are
+  // filled in a run at a time, too.
+  template<typename Rows>
+  slab label_mask(const uint64_t* in, const std::array<uint64_t,3>& dims,
+                  uint64_t z0, uint64_t z1, Rows& rows)
+  {
+    typedef typename Rows::label_type L;
+    slab s;
+    s.z0 = z0;
+    s.z1 = z1;
+    s.roots.assign(1, 0);
+    s.classes.assign(1, 0);
+    if(z0 == z1) { return s; }
+
+    const uint64_t words = mask_words(dims[0]);
+    DisjointSet ds;
+    uint64_t next = 1;
+    for(uint64_t z=z0; z < z1; ++z) {
+      for(uint64_t y=0; y < dims[1]; ++y) {
+        const uint64_t* m = in + ((z-z0)*dims[1] + y)*words;
+        const uint64_t* mbelow = y > 0 ? m - words : NULL;
+        const uint64_t* mbehind = z > z0 ? m - dims[1]*words : NULL;
+        const L* below = y > 0 ? rows.row(z, y-1) : NULL;
+        const L* behind = z > z0 ? rows.row(z-1, y) : NULL;
+        L* cur = rows.row(z, y);
+        std::fill(cur, cur+dims[0], L(0));
+        auto mine = [&](uint64_t w) { return m[w]; };
+        bit_runs(mine, 0, dims[0], [&](uint64_t x0, uint64_t x1) {
+          L lbl = 0;
+          // a neighboring run has one label, so one look at each will do.
+          auto touch = [&](const uint64_t* nm, const L* nl) {
+            auto both = [&](uint64_t w) { return m[w] & nm[w]; };
+            bit_runs(both, x0, x1, [&](uint64_t a, uint64_t) {
+              if(lbl == 0) { lbl = nl[a]; }
+              else if(nl[a] != lbl) { ds.unio(lbl, nl[a]); }
+            });
+          };
+          if(mbelow) { touch(mbelow, below); }
+          if(mbehind) { touch(mbehind, behind); }
+          if(lbl == 0) {
+            lbl = fresh<L>(next);
+            s.classes.push_back(1);
+          }
+          std::fill(cur+x0, cur+x1, lbl);
+        });
+        rows.done(cur);
+      }
+      if(z == z0) { copy_face(rows, dims, z, s.top); }
+    }
+    copy_face(rows, dims, z1-1, s.bottom);
+    resolve(s, ds, next);
+    return s;
+  }
+
+  // rewrites 'n' provisional labels to their final values.  if given,
+  // 'counts' accumulates the size of every final label.
+  template<typename L>
+  void relabel(L* labels, uint64_t n, const std::vector<uint64_t>& map,
+               std::vector<uint64_t>* counts)
+  {
+    for(uint64_t i=0; i < n; ++i) {
+      const uint64_t l = map[labels[i]];
+      labels[i] = static_cast<L>(l);
+      if(counts) { ++(*counts)[l]; }
+    }
+  }
+  // the same for runs.  'counts' does not see the background.
+  void relabel(run* runs, uint64_t n, const std::vector<uint64_t>& map,
+               std::vector<uint64_t>* counts)
+  {
+    for(uint64_t i=0; i < n; ++i) {
+      runs[i].label = map[runs[i].label];
+      if(counts) { (*counts)[runs[i].label] += runs[i].n; }
+    }
+  }
+
+  // a few slabs per thread: when the foreground sits in a few slices, the
+  // threads which got the others steal the rest of the work.  a lone thread
+  // would only pay for the extra faces.
+  size_t slabs_for(const std::array<uint64_t,3>& dims) {
+    const size_t n = tasks::threads() == 1 ? 1 : 4*tasks::threads();
+    return std::max<uint64_t>(1, std::min<uint64_t>(n, dims[2]));
+  }
+
+  // runs 'f(s)' for every slab, in the task pool.
+  template<typename F> void each_slab(size_t nslabs, F f) {
+    tasks::parallel_for(0, nslabs, 1, [&](uint64_t s0, uint64_t s1) {
+      for(uint64_t s=s0; s < s1; ++s) { f(s); }
+    });
+  }
+
+  // relabels without counting, in chunks of this many labels.
+  const uint64_t RELABEL_GRAIN = 1 << 18;
+}
+
+namespace {
+  // labelers give label() or label_mask() a slab, for any Rows.  'in'
+  // points at slice 'zin'.
+  template<typename T> struct by_value {
+    template<typename Rows>
+    slab operator()(uint64_t z0, uint64_t z1, Rows& rows) const {
+      return label(this->in + (z0-this->zin)*this->strides[2], this->dims,
+                   this->strides, this->cls, z0, z1, rows);
+    }
+    const T* in;
+    uint64_t zin;
+    std::array<uint64_t,3> dims, strides;
+    classifier<T> cls;
+  };
+  struct by_mask {
+    template<typename Rows>
+    slab operator()(uint64_t z0, uint64_t z1, Rows& rows) const {
+      const uint64_t slice = mask_words(this->dims[0])*this->dims[1];
+      return label_mask(this->in + (z0-this->zin)*slice, this->dims, z0, z1,
+                        rows);
+    }
+    const uint64_t* in;
+    uint64_t zin;
+    std::array<uint64_t,3> dims;
+  };
+
+  // gets 'n' final labels, from voxel 'first' on, right after they are
+  // written; from several tasks at once.
+  typedef std::function<void(const void* labels, uint64_t first, uint64_t n)>
+    label_hook;
+
+  // labels the whole volume with 'lab', a slab per task, into 'out'.
+  template<typename L, typename Labeler>
+  ccom_stats label_dense(const std::array<uint64_t,3>& dims, L* out,
+                         const Labeler& lab,
+                         const label_hook& written = label_hook())
+  {
+    const uint64_t slice = dims[0]*dims[1];
+    const size_t nslabs = slabs_for(dims);
+    std::vector<slab> slabs(nslabs);
+    each_slab(nslabs, [&](size_t s) {
+      const std::pair<uint64_t,uint64_t> zs = slab_range(dims[2], nslabs, s);
+      dense_rows<L> rows(out + zs.first*slice, dims, zs.first);
+      slabs[s] = lab(zs.first, zs.second, rows);
+    });
+
+    ccom_stats stats;
+    const std::vector<std::vector<uint64_t>> maps = merge_slabs(
+      slabs, stats.components, &stats.classes
+    );
+    check_labels(stats.components, sizeof(L));
+
+    stats.voxels.assign(stats.components+1, 0);
+    std::mutex total;
+    each_slab(nslabs, [&](size_t s) {
+      std::vector<uint64_t> counts(stats.components+1, 0);
+      const uint64_t first = slabs[s].z0*slice;
+      const uint64_t n = (slabs[s].z1-slabs[s].z0)*slice;
+      relabel(out + first, n, maps[s], &counts);
+      if(written) { written(out + first, first, n); } // while it's in cache.
+      std::lock_guard<std::mutex> lk(total);
+      for(size_t l=0; l < counts.size(); ++l) { stats.voxels[l] += counts[l]; }
+    });
+    return stats;
+  }
+
+  // ... or into runs.
+  template<typename Labeler>
+  ccom_stats label_runs(const std::array<uint64_t,3>& dims, run_volume& out,
+                        const Labeler& lab)
+  {
+    const size_t nslabs = slabs_for(dims);
+    std::vector<slab> slabs(nslabs);
+    std::vector<run_volume> parts(nslabs);
+    each_slab(nslabs, [&](size_t s) {
+      const std::pair<uint64_t,uint64_t> zs = slab_range(dims[2], nslabs, s);
+      std::array<uint64_t,3> part = dims;
+      part[2] = zs.second - zs.first;
+      parts[s] = run_volume(part);
+      run_rows rows(parts[s], dims, zs.first);
+      slabs[s] = lab(zs.first, zs.second, rows);
+    });
+
+    ccom_stats stats;
+    const std::vector<std::vector<uint64_t>> maps = merge_slabs(
+      slabs, stats.components, &stats.classes
+    );
+
+    stats.voxels.assign(stats.components+1, 0);
+    std::mutex total;
+    each_slab(nslabs, [&](size_t s) {
+      std::vector<uint64_t> counts(stats.components+1, 0);
+      relabel(parts[s].runs.data(), parts[s].runs.size(), maps[s], &counts);
+      std::lock_guard<std::mutex> lk(total);
+      for(size_t l=1; l < counts.size(); ++l) { stats.voxels[l] += counts[l]; }
+    });
+    uint64_t foreground = 0;
+    for(size_t l=1; l < stats.voxels.size(); ++l) {
+      foreground += stats.voxels[l];
+    }
+    stats.voxels[0] = dims[0]*dims[1]*dims[2] - foreground;
+
+    out = concatenate(parts);
+    out.dims = dims; // even if there are no slices.
+    out.components = stats.components;
+    return stats;
+  }
+}
+
+template<typename T, typename L>
+ccom_stats ccom(const T* in, const std::array<uint64_t,3>& dims,
+                const std::array<uint64_t,3>& strides,
+                const std::vector<band<T>>& component, L* out)
+{
+  const by_value<T> lab = { in, 0, dims, strides, classifier<T>(component) };
+  return label_dense(dims, out, lab);
+}
+
+template<typename T>
+ccom_stats ccom(const T* in, const std::array<uint64_t,3>& dims,
+                const std::array<uint64_t,3>& strides,
+                const std::vector<band<T>>& component, run_volume& out)
+{
+  const by_value<T> lab = { in, 0, dims, strides, classifier<T>(component) };
+  return label_runs(dims, out, lab);
+}
+
+template<typename L>
+ccom_stats ccom_mask(const uint64_t* mask, const std::array<uint64_t,3>& dims,
+                     L* out)
+{
+  const by_mask lab = { mask, 0, dims };
+  return label_dense(dims, out, lab);
+}
+
+ccom_stats ccom_mask(const uint64_t* mask, const std::array<uint64_t,3>& dims,
+                     run_volume& out)
+{
+  const by_mask lab = { mask, 0, dims };
+  return label_runs(dims, out, lab);
+}
+template ccom_stats ccom_mask(const uint64_t*, const std::array<uint64_t,3>&,
+                              uint8_t*);
+template ccom_stats ccom_mask(const uint64_t*, const std::array<uint64_t,3>&,
+                              uint16_t*);
+template ccom_stats ccom_mask(const uint64_t*, const std::array<uint64_t,3>&,
+                              uint32_t*);
+template ccom_stats ccom_mask(const uint64_t*, const std::array<uint64_t,3>&,
+                              uint64_t*);
+
+#define CCOM(T, L) \
+  template ccom_stats ccom(const T*, const std::array<uint64_t,3>&, \
+                           const std::array<uint64_t,3>&, \
+                           const std::vector<band<T>>&, L*)
+#define CCOM_LABELS(T) \
+  CCOM(T, uint8_t); CCOM(T, uint16_t); CCOM(T, uint32_t); CCOM(T, uint64_t); \
+  template ccom_stats ccom(const T*, const std::array<uint64_t,3>&, \
+                           const std::array<uint64_t,3>&, \
+                           const std::vector<band<T>>&, run_volume&)
+CCOM_LABELS(uint8_t); CCOM_LABELS(uint16_t);
+CCOM_LABELS(uint32_t); CCOM_LABELS(uint64_t);
+CCOM_LABELS(int8_t); CCOM_LABELS(int16_t);
+CCOM_LABELS(int32_t); CCOM_LABELS(int64_t);
+CCOM_LABELS(float); CCOM_LABELS(double);
+#undef CCOM_LABELS
+#undef CCOM
+
+namespace {
+  // everything the file-based phases need to know, pulled out of the config.
+  struct job {
+    // takes the input from 'resident' rather than from the config, if given.
+    // with a 'step', the job is that timestep of the config's 'series'.
+    explicit job(const char* fn_config, cached_volume* resident=NULL,
+                 int64_t step=-1);
+    uint64_t slice() const { return dims[0]*dims[1]; }
+    uint64_t voxels() const { return slice()*dims[2]; }
+    uint64_t bytes() const { return voxels() * nrrd::bytes(ltype); }
+    // bytes in a slice of the input; a mask's scanlines are whole words.
+    uint64_t in_slice() const {
+      return intype == nrrd::BIT ? mask_bytes({{indims[0], indims[1], 1}}) :
+                                   indims[0]*indims[1]*nrrd::bytes(intype);
+    }
+    // where slice 'z' of the region starts, in bytes into the input.
+    uint64_t in_offset(uint64_t z) const {
+      if(intype == nrrd::BIT) { return z*in_slice(); } // masks are not cut.
+      const std::array<uint64_t,3> s = dense_strides(indims);
+      return (roi_start(region, s) + z*region.stride[2]*s[2]) *
+             nrrd::bytes(intype);
+    }
+    // the region's strides in the input, as 'input' gives it.
+    std::array<uint64_t,3> in_strides() const {
+      std::array<uint64_t,3> s = roi_strides(region, dense_strides(indims));
+      if(tiffin) { s[2] = indims[0]*indims[1]; } // only its slices decode.
+      return s;
+    }
+
+    std::array<uint64_t,3> dims; // of the region, which we label.
+    std::array<uint64_t,3> indims;
+    roi region;
+    std::string inraw; // the raw data, or a TIFF stack.
+    nrrd::dtype intype;
+    bool tiffin;
+    const void* resident; // the input, already in memory; else NULL.
+    std::string outraw, outnhdr;
+    std::string outindex; // where the component index goes; empty for none.
+    std::string outclasses; // where the label->class table goes, if anywhere.
+    // the intervals of every class, and the classes' names.
+    std::vector<std::vector<interval>> classes;
+    std::vector<std::string> names;
+    nrrd::dtype ltype; // type of the labels we write.
+    bool runs; // write runs (see runs.h) instead of a raw label volume.
+    bool tiff; // write a TIFF stack (see tiff-stack.h) instead.
+  };
+
+  nrrd::dtype label_type(std::string t) {
+    if(t == "uint8") { return nrrd::UINT8; }
+    if(t == "uint16") { return nrrd::UINT16; }
+    if(t == "uint32") { return nrrd::UINT32; }
+    if(t == "uint64") { return nrrd::UINT64; }
+    throw std::invalid_argument("outtype must be uint8, uint16, uint32 or "
+                                "uint64");
+  }
+
+  // the inputs of a series, in order.
+  std::vector<std::string> series_inputs(config& cfg) {
+    std::istringstream is(cfg.value("series"));
+    const std::vector<std::string> in((std::istream_iterator<std::string>(is)),
+                                      std::istream_iterator<std::string>());
+    if(in.empty()) { throw std::invalid_argument("the series is empty"); }
+    return in;
+  }
+
+  // the name for timestep 't' of a series: the run of '#'s in 'pattern'
+  // becomes t, zero padded to the run's length.
+  std::string step_name(std::string pattern, size_t t) {
+    const size_t b = pattern.find('#');
+    if(b == std::string::npos) {
+      throw std::invalid_argument("'" + pattern + "' needs a '#' for the "
+                                  "timestep");
+    }
+    const size_t e = pattern.find_first_not_of('#', b);
+    const size_t n = (e == std::string::npos ? pattern.size() : e) - b;
+    std::ostringstream os;
+    os << std::setw(n) << std::setfill('0') << t;
+    return pattern.replace(b, n, os.str());
+  }
+
+  job::job(const char* fn_config, cached_volume* resident, int64_t step) :
+    resident(NULL) {
+    config cfg(fn_config);
+
+    const std::string in = step < 0 ? cfg.value("in") :
+                                      series_inputs(cfg).at(step);
+    this->tiffin = !resident && is_tiff(in);
+    if(resident) {
+      this->indims = resident->dims();
+      this->inraw = resident->path();
+      this->intype = resident->type();
+      this->resident = resident->data();
+    } else if(this->tiffin) {
+      const tiff_stack stack(in);
+      this->indims = stack.dims();
+      this->inraw = in;
+      this->intype = stack.type();
+    } else {
+      nrrd innhdr(in.c_str());
+      assert(innhdr.n_dimensions() == 3); // can't handle more, right now.
+      this->indims = innhdr.dimensions();
+      this->inraw = innhdr.datafile();
+      this->intype = innhdr.datatype();
+    }
+    const std::string region = cfg.value("roi", "");
+    this->region = region.empty() ? whole_roi(this->indims) :
+                                    parse_roi(region, this->indims);
+    if(!region.empty() && this->intype == nrrd::BIT) {
+      throw std::domain_error("a mask cannot be cut to a region");
+    }
+    this->dims = roi_dims(this->region);
+
+    const std::string format = cfg.value("outformat", "raw");
+    if(format != "raw" && format != "runs" && format != "tiff") {
+      throw std::invalid_argument("outformat must be raw, runs or tiff");
+    }
+    this->runs = format == "runs";
+    this->tiff = format == "tiff";
+    this->outraw = cfg.value("outraw");
+    // runs files and TIFFs describe themselves.
+    this->outnhdr = format != "raw" ? "" : cfg.value("outnhdr");
+    this->outindex = cfg.value("outindex", "");
 
-        // merge any one neighbor?
-        if(cequal({{x-1,y,z}}, {{x,y,z}})) { // x, left neighbor
-          labels[idx({{x,y,z}})] = labels[idx({{x-1,y,z}})];
-          ds.unio(labels[idx({{x-1,y,z}})], labels[idx({{x,y,z}})]);
-          continue;
+    this->outclasses = cfg.value("outclasses", "");
+    if(step >= 0) {
+      if(format != "raw") {
+        throw std::invalid_argument("a series needs 'outformat: raw'");
+      }
+      this->outraw = step_name(this->outraw, step);
+      this->outnhdr = step_name(this->outnhdr, step);
+      if(!this->outindex.empty()) {
+        this->outindex = step_name(this->outindex, step);
+      }
+      if(!this->outclasses.empty()) {
+        this->outclasses = step_name(this->outclasses, step);
+      }
+    }
+
+    // the default is narrow, but note that *provisional* labels (before
+    // slabs are merged) must fit into this type as well.
+    this->ltype = label_type(cfg.value("outtype", "uint8"));
+
+    // a mask is its own component.
+    if(this->intype == nrrd::BIT) {
+      this->classes.resize(1);
+      this->names.assign(1, "component");
+      return;
+    }
+    // either one 'component', or any number of 'component.<name>' classes.
+    const std::string fn = this->inraw;
+    auto_bounds fromfile = this->tiffin ?
+      auto_bounds([fn](uint64_t stride) {
+        return make_histogram(tiff_stack(fn), stride);
+      }) : auto_bounds(this->inraw, this->intype);
+    auto_bounds& automatic = resident ? resident->bounds() : fromfile;
+    const std::string prefix = "component.";
+    for(const std::string& k : cfg.keys()) {
+      if(k != "component" && k.compare(0, prefix.size(), prefix) != 0) {
+        continue;
+      }
+      const std::string name = k == "component" ? k : k.substr(prefix.size());
+      if(std::find(this->names.begin(), this->names.end(), name) !=
+         this->names.end()) {
+        continue; // the first one wins, as with any other key.
+      }
+      std::istringstream iss(cfg.value(k));
+      this->classes.push_back(equivalences(iss, automatic));
+      this->names.push_back(name);
+    }
+    if(this->classes.empty()) {
+      throw std::invalid_argument("no 'component' given");
+    }
+  }
+
+  // creates 'fn' at exactly 'bytes' bytes.
+  void size_output(std::string fn, uint64_t bytes) {
+    const int fd = ::open(fn.c_str(), O_WRONLY | O_CREAT,
+                          S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if(fd == -1) {
+      throw std::runtime_error("could not create '" + fn + "'");
+    }
+    const int tr = ::ftruncate(fd, bytes);
+    ::close(fd);
+    if(tr != 0) {
+      throw std::runtime_error("could not size '" + fn + "'");
+    }
+  }
+
+  // slices [z0,z1) of the input: resident, mapped, or decoded from a TIFF
+  // stack.  empty volumes have nothing to map.
+  struct input {
+    input(const job& j, uint64_t z0, uint64_t z1) :
+      offset(j.in_offset(z0)), at(NULL) {
+      if(j.resident) {
+        this->at = static_cast<const char*>(j.resident) + this->offset;
+        return;
+      }
+      if(j.tiffin) {
+        // just the region's slices.
+        const tiff_stack stack(j.inraw);
+        const uint64_t zin = j.region.offset[2], step = j.region.stride[2];
+        this->decoded.resize((z1-z0)*j.in_slice());
+        if(step == 1) {
+          stack.read(zin+z0, zin+z1, this->decoded.data());
+        } else {
+          for(uint64_t z=z0; z < z1; ++z) {
+            stack.read(zin + z*step, zin + z*step+1,
+                       this->decoded.data() + (z-z0)*j.in_slice());
+          }
         }
-        if(cequal({{x,y-1,z}}, {{x,y,z}})) { // y, neighbor underneath
-          labels[idx({{x,y,z}})] = labels[idx({{x,y-1,z}})];
-          ds.unio(labels[idx({{x,y-1,z}})], labels[idx({{x,y,z}})]);
-          continue;
+        this->offset = j.in_offset(0) - zin*j.in_slice();
+        return;
+      }
+      // pages outside the region's scanlines are never touched, so never
+      // read.
+      this->mem.reset(new memory(j.inraw.c_str()));
+      if(j.voxels() > 0 && (!*this->mem ||
+         this->mem->length < j.indims[2]*j.in_slice())) {
+        throw std::runtime_error("cannot read '" + j.inraw + "'");
+      }
+    }
+    const void* data() const {
+      if(this->at) { return this->at; }
+      if(!this->mem) { return this->decoded.data() + this->offset; }
+      return *this->mem ? static_cast<const char*>(this->mem->map) +
+                          this->offset : NULL;
+    }
+    std::unique_ptr<memory> mem;
+    std::vector<char> decoded;
+    uint64_t offset;
+    const char* at; // into the resident input
+  };
+
+  // maps slices [z0,z1) of the output.
+  struct output {
+    output(const job& j, uint64_t z0, uint64_t z1) :
+      mem(j.outraw.c_str(), (z1-z0)*j.slice()*nrrd::bytes(j.ltype),
+          z0*j.slice()*nrrd::bytes(j.ltype)) {
+      if(!mem) { throw std::runtime_error("could not map '" + j.outraw + "'"); }
+    }
+    memory mem;
+  };
+
+  // the dimensions of slab 's'.
+  std::array<uint64_t,3> slab_dims(const job& j, size_t s, size_t nslabs) {
+    const std::pair<uint64_t,uint64_t> zs = slab_range(j.dims[2], nslabs, s);
+    std::array<uint64_t,3> d = j.dims;
+    d[2] = zs.second - zs.first;
+    return d;
+  }
+
+  // the input type of bit-packed masks.
+  struct bit {};
+
+  // the labeler for the job's input, of type T; 'in' points at slice 'zin'.
+  template<typename T> struct source {
+    static by_value<T> at(const job& j, const void* in, uint64_t zin) {
+      const by_value<T> lab = {
+        static_cast<const T*>(in), zin, j.dims, j.in_strides(),
+        classifier<T>(bands_of<T>(j.classes))
+      };
+      return lab;
+    }
+  };
+  template<> struct source<bit> {
+    static by_mask at(const job& j, const void* in, uint64_t zin) {
+      const by_mask lab = { static_cast<const uint64_t*>(in), zin, j.dims };
+      return lab;
+    }
+  };
+
+  template<typename T> struct run_phases;
+
+  // the phases, for one combination of input type T and label type L.
+  template<typename T, typename L> struct phases {
+    // 'written' sees the labels of a raw output as they are written.
+    static ccom_stats whole(const job& j, const label_hook& written) {
+      if(j.tiff) { return tiff_whole(j); }
+      input in(j, 0, j.dims[2]);
+      output out(j, 0, j.dims[2]);
+      return label_dense(j.dims, static_cast<L*>(out.mem.map),
+                         source<T>::at(j, in.data(), 0), written);
+    }
+    static slab label_slab(const job& j, size_t s, size_t nslabs) {
+      const std::pair<uint64_t,uint64_t> zs = slab_range(j.dims[2], nslabs, s);
+      if(zs.first == zs.second || j.slice() == 0) { // nothing to map.
+        slab empty;
+        empty.z0 = zs.first;
+        empty.z1 = zs.second;
+        empty.roots.assign(1, 0);
+        empty.classes.assign(1, 0);
+        return empty;
+      }
+      input in(j, zs.first, zs.second);
+      output out(j, zs.first, zs.second);
+      dense_rows<L> rows(static_cast<L*>(out.mem.map), j.dims, zs.first);
+      return source<T>::at(j, in.data(), zs.first)(zs.first, zs.second, rows);
+    }
+    static void relabel_slab(const job& j, size_t s, size_t nslabs,
+                             const std::vector<uint64_t>& map) {
+      const std::pair<uint64_t,uint64_t> zs = slab_range(j.dims[2], nslabs, s);
+      const uint64_t n = (zs.second - zs.first)*j.slice();
+      if(n == 0) { return; }
+      output out(j, zs.first, zs.second);
+      L* labels = static_cast<L*>(out.mem.map);
+      tasks::parallel_for(0, n, RELABEL_GRAIN, [&](uint64_t b, uint64_t e) {
+        relabel(labels + b, e-b, map, NULL);
+      });
+    }
+    // the labels stay runs, which are small next to the volume; pages are
+    // expanded from them a few at a time.  the index comes from the runs,
+    // too, rather than from decoding the stack again.
+    static ccom_stats tiff_whole(const job& j) {
+      run_volume v;
+      const ccom_stats stats = run_phases<T>::label(j, v);
+      check_labels(stats.components, sizeof(L));
+      tiff_writer out(j.outraw, j.dims, j.ltype);
+      const uint64_t per = std::max<uint64_t>(1, tasks::threads());
+      std::vector<L> labels(std::min(per, j.dims[2])*j.slice());
+      for(uint64_t z=0; z < j.dims[2]; z += per) {
+        const std::array<uint64_t,3> d = {{
+          j.dims[0], j.dims[1], std::min(per, j.dims[2]-z)
+        }};
+        expand(d, v.index.data() + z*j.dims[1], v.runs.data(), labels.data());
+        out.write(z, z+d[2], labels.data());
+      }
+      if(!j.outindex.empty()) {
+        write_index(j.outindex, index_components(v.dims, v.index.data(),
+                                                 v.runs.data()));
+      }
+      return stats;
+    }
+  };
+
+  // ... and for runs output, where the label type plays no role.
+  template<typename T> struct run_phases {
+    static ccom_stats label(const job& j, run_volume& v) {
+      input in(j, 0, j.dims[2]);
+      return label_runs(j.dims, v, source<T>::at(j, in.data(), 0));
+    }
+    static ccom_stats whole(const job& j) {
+      run_volume v;
+      const ccom_stats stats = label(j, v);
+      write_runs(j.outraw, v);
+      return stats;
+    }
+    static slab label_slab(const job& j, size_t s, size_t nslabs) {
+      const std::pair<uint64_t,uint64_t> zs = slab_range(j.dims[2], nslabs, s);
+      run_volume v(slab_dims(j, s, nslabs));
+      input in(j, zs.first, zs.second);
+      run_rows rows(v, j.dims, zs.first);
+      const slab sl = source<T>::at(j, in.data(), zs.first)(zs.first,
+                                                            zs.second, rows);
+      write_runs(slab_runs_fn(j.outraw, s), v);
+      return sl;
+    }
+  };
+
+  // the output's header and index, built from the slabs' own indices.  the
+  // runs themselves are filled in by relabel_runs.
+  void merge_runs(const job& j, size_t nslabs, uint64_t components) {
+    run_volume head(j.dims);
+    head.components = components;
+    for(size_t s=0; s < nslabs; ++s) {
+      const run_file part(slab_runs_fn(j.outraw, s));
+      const uint64_t scanlines = part.dims()[1]*part.dims()[2];
+      const uint64_t base = head.index.back();
+      for(uint64_t i=1; i <= scanlines; ++i) {
+        head.index.push_back(base + part.index()[i]);
+      }
+    }
+    if(head.index.size() != j.dims[1]*j.dims[2] + 1) {
+      throw std::length_error("slab runs do not cover the volume");
+    }
+    write_runs(j.outraw, head);
+    size_output(j.outraw, runs_offset(j.dims) + head.index.back()*sizeof(run));
+  }
+
+  void relabel_runs(const job& j, size_t s, size_t nslabs,
+                    const std::vector<uint64_t>& map) {
+    const std::string fn = slab_runs_fn(j.outraw, s);
+    {
+      const run_file part(fn);
+      const uint64_t n = part.index()[part.dims()[1]*part.dims()[2]];
+      if(n > 0) {
+        const uint64_t z0 = slab_range(j.dims[2], nslabs, s).first;
+        const uint64_t base = run_file(j.outraw).index()[z0*j.dims[1]];
+        memory out(j.outraw.c_str(), n*sizeof(run),
+                   runs_offset(j.dims) + base*sizeof(run));
+        if(!out) {
+          throw std::runtime_error("could not map '" + j.outraw + "'");
         }
-        if(cequal({{x,y,z-1}}, {{x,y,z}})) { // z, neighbor behind
-          labels[idx({{x,y,z}})] = labels[idx({{x,y,z-1}})];
-          ds.unio(labels[idx({{x,y,z-1}})], labels[idx({{x,y,z}})]);
-          continue;
+        run* runs = static_cast<run*>(out.map);
+        tasks::parallel_for(0, n, RELABEL_GRAIN, [&](uint64_t b, uint64_t e) {
+          std::copy(part.runs()+b, part.runs()+e, runs+b);
+          relabel(runs+b, e-b, map, NULL);
+        });
+      }
+    }
+    remove(fn.c_str());
+  }
+
+  // calls phases<T,L>::call, with the input type T and label type L of the
+  // job 'j'; or run_phases<T>::call, for runs output.
+#define TJF_BY_LABEL(T, call) \
+    switch(j.ltype) { \
+      case nrrd::UINT8: return phases<T, uint8_t>::call; \
+      case nrrd::UINT16: return phases<T, uint16_t>::call; \
+      case nrrd::UINT32: return phases<T, uint32_t>::call; \
+      case nrrd::UINT64: return phases<T, uint64_t>::call; \
+      default: throw std::domain_error("labels must be unsigned integers"); \
+    }
+#define TJF_RUNS(T, call) return run_phases<T>::call;
+#define TJF_DISPATCH(BY, call) \
+  switch(j.intype) { \
+    case nrrd:: UINT8: BY( uint8_t, call) \
+    case nrrd::UINT16: BY(uint16_t, call) \
+    case nrrd::UINT32: BY(uint32_t, call) \
+    case nrrd::UINT64: BY(uint64_t, call) \
+    case nrrd:: INT8: BY( int8_t, call) \
+    case nrrd::INT16: BY(int16_t, call) \
+    case nrrd::INT32: BY(int32_t, call) \
+    case nrrd::INT64: BY(int64_t, call) \
+    case nrrd::FLOAT: BY(float, call) \
+    case nrrd::DOUBLE: BY(double, call) \
+    case nrrd::BIT: BY(bit, call) \
+  } \
+  throw std::domain_error("unknown type");
+
+  ccom_stats whole(const job& j, const label_hook& written) {
+    if(j.runs) { TJF_DISPATCH(TJF_RUNS, whole(j)) }
+    TJF_DISPATCH(TJF_BY_LABEL, whole(j, written))
+  }
+  slab label_slab(const job& j, size_t s, size_t nslabs) {
+    if(j.runs) { TJF_DISPATCH(TJF_RUNS, label_slab(j, s, nslabs)) }
+    TJF_DISPATCH(TJF_BY_LABEL, label_slab(j, s, nslabs))
+  }
+  void relabel_slab(const job& j, size_t s, size_t nslabs,
+                    const std::vector<uint64_t>& map) {
+    if(j.runs) { return relabel_runs(j, s, nslabs, map); }
+    TJF_DISPATCH(TJF_BY_LABEL, relabel_slab(j, s, nslabs, map))
+  }
+#undef TJF_DISPATCH
+#undef TJF_RUNS
+#undef TJF_BY_LABEL
+
+  // one "label class" line per component, if the config asks for it.
+  void write_classes(const job& j, const std::vector<uint8_t>& classes) {
+    if(j.outclasses.empty()) { return; }
+    std::ofstream ofs(j.outclasses.c_str(), std::ios::trunc);
+    for(size_t l=1; l < classes.size(); ++l) {
+      ofs << l << " " << j.names[classes[l]-1] << "\n";
+    }
+    if(!ofs) {
+      throw std::runtime_error("could not write '" + j.outclasses + "'");
+    }
+  }
+
+  template<typename L> component_index index_raw(const job& j) {
+    if(j.voxels() == 0) { return index_components<L>(NULL, j.dims); }
+    if(j.tiff) {
+      std::vector<L> labels(j.voxels());
+      tiff_stack(j.outraw).read(0, j.dims[2], labels.data());
+      return index_components(labels.data(), j.dims);
+    }
+    const memory labels(j.outraw.c_str());
+    if(!labels || labels.length < j.bytes()) {
+      throw std::runtime_error("cannot read '" + j.outraw + "'");
+    }
+    return index_components(static_cast<const L*>(labels.map), j.dims);
+  }
+
+  void index_output(const job& j) {
+    if(j.outindex.empty()) { return; }
+    component_index idx;
+    if(j.runs) {
+      const run_file r(j.outraw);
+      idx = index_components(r.dims(), r.index(), r.runs());
+    } else {
+      switch(j.ltype) {
+        case nrrd::UINT8: idx = index_raw<uint8_t>(j); break;
+        case nrrd::UINT16: idx = index_raw<uint16_t>(j); break;
+        case nrrd::UINT32: idx = index_raw<uint32_t>(j); break;
+        default: idx = index_raw<uint64_t>(j); break;
+      }
+    }
+    write_index(j.outindex, idx);
+  }
+
+  // the single process interface.  'written' sees a raw output's labels as
+  // they are written.
+  ccom_stats label_all(const job& j,
+                       const label_hook& written = label_hook()) {
+    std::clog << "Creating '" << j.outraw << "' output file.\n";
+    ccom_stats stats;
+    stats.components = 0;
+    stats.classes.assign(1, 0);
+    if(j.runs || j.tiff) {
+      stats = whole(j, label_hook());
+    } else {
+      size_output(j.outraw, j.bytes());
+      if(j.voxels() > 0) { stats = whole(j, written); }
+      nrrd::write_header(j.outnhdr, j.dims, j.ltype, j.outraw, j.region);
+    }
+    std::clog << stats.components << " components.\n";
+    write_classes(j, stats.classes);
+    if(!j.tiff) { index_output(j); } // a TIFF's comes with its labels.
+    return stats;
+  }
+
+  // how many voxels label 'prev' of one timestep and label 'cur' of the
+  // next share.
+  struct overlap {
+    uint64_t prev, cur, voxels;
+  };
+  struct pair_hash {
+    size_t operator()(const std::pair<uint64_t,uint64_t>& p) const {
+      return std::hash<uint64_t>()(p.first * 0x9e3779b97f4a7c15ull ^
+                                   p.second);
+    }
+  };
+  typedef std::unordered_map<std::pair<uint64_t,uint64_t>, uint64_t,
+                             pair_hash> overlap_map;
+
+  // labels 'cur', and counts every pair of overlapping labels in the output
+  // of 'prev' and its own, a slab at a time as its final labels are
+  // written.  labels are dense, so the pairs are few next to the voxels.
+  template<typename L>
+  std::vector<overlap> label_overlaps(const job& prev, const job& cur,
+                                      ccom_stats& stats) {
+    if(cur.voxels() == 0) {
+      stats = label_all(cur);
+      return std::vector<overlap>();
+    }
+    const memory lp(prev.outraw.c_str());
+    if(!lp || lp.length < prev.bytes()) {
+      throw std::runtime_error("cannot read '" + prev.outraw + "'");
+    }
+    const L* pa = static_cast<const L*>(lp.map);
+    std::mutex merge;
+    overlap_map all;
+    stats = label_all(cur, [&](const void* labels, uint64_t first,
+                               uint64_t n) {
+      const L* pb = static_cast<const L*>(labels);
+      overlap_map m;
+      for(uint64_t i=0; i < n; ++i) {
+        if(pa[first+i] != 0 && pb[i] != 0) {
+          ++m[std::make_pair(pa[first+i], pb[i])];
         }
+      }
+      std::lock_guard<std::mutex> lk(merge);
+      for(const auto& e : m) { all[e.first] += e.second; }
+    });
+    std::vector<overlap> out;
+    out.reserve(all.size());
+    for(const auto& e : all) {
+      const overlap o = { e.first.first, e.first.second, e.second };
+      out.push_back(o);
+    }
+    // by label, then the largest overlap first.
+    std::sort(out.begin(), out.end(), [](const overlap& x, const overlap& y) {
+      return x.cur != y.cur ? x.cur < y.cur :
+             x.voxels != y.voxels ? x.voxels > y.voxels : x.prev < y.prev;
+    });
+    return out;
+  }
 
-        // merges nobody, then!  assign a new label.
-        #pragma omp critical
-        {
-          labels[idx({{x,y,z}})] = identifier++;
-          ds.unio(labels[idx({{x,y,z}})], labels[idx({{x,y,z}})]);
+  // follows components through a series.  a component continues the track
+  // of the previous component it overlaps most, if that one overlaps it
+  // more than any other; anything else starts a new track.
+  struct tracker {
+    tracker() : ntracks(0) { }
+
+    // writes the table for a timestep, given its components' sizes and
+    // their overlaps with the previous timestep's, sorted as label_overlaps()
+    // sorts them.
+    void step(std::string fn, const std::vector<uint64_t>& voxels,
+              const std::vector<overlap>& ov) {
+      std::vector<uint64_t> best_next(this->tracks.size(), 0);
+      std::vector<uint64_t> most(this->tracks.size(), 0);
+      for(const overlap& o : ov) {
+        if(o.voxels > most[o.prev]) {
+          most[o.prev] = o.voxels;
+          best_next[o.prev] = o.cur;
+        }
+      }
+      std::ofstream ofs(fn.c_str(), std::ios::trunc);
+      ofs << "# label voxels track previous:overlap...\n";
+      std::vector<uint64_t> next(voxels.size(), 0);
+      std::vector<overlap>::const_iterator o = ov.begin();
+      for(uint64_t l=1; l < voxels.size(); ++l) {
+        const std::vector<overlap>::const_iterator b = o;
+        while(o != ov.end() && o->cur == l) { ++o; }
+        // the first overlap is the largest.
+        next[l] = b != o && best_next[b->prev] == l ? this->tracks[b->prev] :
+                                                      ++this->ntracks;
+        ofs << l << " " << voxels[l] << " " << next[l];
+        for(std::vector<overlap>::const_iterator i=b; i != o; ++i) {
+          ofs << " " << i->prev << ":" << i->voxels;
         }
+        ofs << "\n";
       }
+      if(!ofs) { throw std::runtime_error("could not write '" + fn + "'"); }
+      this->tracks.swap(next);
     }
+
+    std::vector<uint64_t> tracks; ///< of the last step's labels
+    uint64_t ntracks;
+  };
+}
+
+void ccom(const char* fn_config) { label_all(job(fn_config)); }
+
+ccom_stats ccom(const char* fn_config, cached_volume& in) {
+  return label_all(job(fn_config, &in));
+}
+
+void ccom_series(const char* fn_config) {
+  std::vector<job> jobs;
+  std::string outtracks;
+  {
+    config cfg(fn_config);
+    const size_t n = series_inputs(cfg).size();
+    for(size_t t=0; t < n; ++t) { jobs.push_back(job(fn_config, NULL, t)); }
+    outtracks = cfg.value("outtracks", "");
   }
-  std::clog << "\r" << "                                                     ";
-  if(bytes > 0) {
-    auto last = idx({{dims[0]-1, dims[1]-1, dims[2]-1}}) /
-                omp_get_num_threads();
-    std::clog << "\r" << last << " / " << last << " ("
-              << static_cast<double>(last) / last * 100.0 << "%)...\n";
+  for(const job& j : jobs) {
+    if(j.dims != jobs[0].dims) {
+      throw std::invalid_argument("'" + j.inraw + "' differs in size");
+    }
   }
-  std::clog << "\rPass 2...\n";
-  std::clog << "components:\n";
-  ds.print();
-  std::clog << "\n";
-  for(uint64_t z=0; z < dims[2]; ++z) {
-    for(uint64_t y=0; y < dims[1]; ++y) {
-      for(uint64_t x=0; x < dims[0]; ++x) {
-        // 0 is special; it's a known separator.
-        if(labels[idx({{x,y,z}})] != 0) {
-          labels[idx({{x,y,z}})] = ds.find(labels[idx({{x,y,z}})]);
-        }
+
+  // timestep t is matched up with t-1 while it is labeled.
+  tracker tr;
+  for(size_t t=0; t < jobs.size(); ++t) {
+    if(outtracks.empty()) {
+      label_all(jobs[t]);
+      continue;
+    }
+    ccom_stats stats;
+    std::vector<overlap> ov;
+    if(t == 0) {
+      stats = label_all(jobs[t]);
+    } else {
+      const job& a = jobs[t-1];
+      const job& b = jobs[t];
+      switch(b.ltype) {
+        case nrrd::UINT8: ov = label_overlaps<uint8_t>(a, b, stats); break;
+        case nrrd::UINT16: ov = label_overlaps<uint16_t>(a, b, stats); break;
+        case nrrd::UINT32: ov = label_overlaps<uint32_t>(a, b, stats); break;
+        default: ov = label_overlaps<uint64_t>(a, b, stats); break;
       }
     }
+    tr.step(step_name(outtracks, t), stats.voxels, ov);
+  }
+}
+
+void ccom_label_slab(const char* fn_config, size_t s, size_t nslabs) {
+  const job j(fn_config);
+  if(j.tiff) {
+    throw std::invalid_argument("TIFF output needs a single process");
+  }
+  write_slab(slab_fn(j.outraw, s), label_slab(j, s, nslabs));
+}
+
+void ccom_merge(const char* fn_config, size_t nslabs) {
+  const job j(fn_config);
+
+  std::vector<slab> slabs(nslabs);
+  for(size_t s=0; s < nslabs; ++s) {
+    slabs[s] = read_slab(slab_fn(j.outraw, s));
+  }
+  uint64_t components;
+  std::vector<uint8_t> classes;
+  const std::vector<std::vector<uint64_t>> maps = merge_slabs(slabs,
+                                                              components,
+                                                              &classes);
+  // runs keep 64 bit labels; a raw output must hold them before any map
+  // goes out.
+  if(!j.runs) { check_labels(components, nrrd::bytes(j.ltype)); }
+  std::clog << components << " components.\n";
+  write_classes(j, classes);
+  for(size_t s=0; s < nslabs; ++s) {
+    write_map(slab_map_fn(j.outraw, s), maps[s]);
+    remove(slab_fn(j.outraw, s).c_str());
   }
-  out.close();
 
-  std::ofstream onhdr(cfg.value("outnhdr").c_str(), std::ios::out);
-  onhdr << "NRRD0002\n"
-        << "dimension: 3\n"
-        << "sizes: " << dims[0] << " " << dims[1] << " " << dims[2] << "\n"
-        << "type: " << "uint8" << "\n"
-        << "encoding: raw\n"
-        << "data file: " << cfg.value("outraw") << "\n";
-  onhdr.close();
+  if(j.runs) {
+    merge_runs(j, nslabs, components);
+    return;
+  }
+  // no-op, unless stale data sits past the end.
+  size_output(j.outraw, j.bytes());
+  nrrd::write_header(j.outnhdr, j.dims, j.ltype, j.outraw, j.region);
 }
+
+void ccom_relabel_slab(const char* fn_config, size_t s, size_t nslabs) {
+  const job j(fn_config);
+  relabel_slab(j, s, nslabs, read_map(slab_map_fn(j.outraw, s)));
+  remove(slab_map_fn(j.outraw, s).c_str());
+}
+
+void ccom_index(const char* fn_config) { index_output(job(fn_config)); }
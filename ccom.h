@@ -1,6 +1,93 @@
 #ifndef TJF_CCOM_H
 #define TJF_CCOM_H
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "classify.h"
+#include "runs.h"
+
+class cached_volume;
+
+struct ccom_stats {
+  uint64_t components;
+  /// voxels[l] is the size of component l; voxels[0] counts the background.
+  std::vector<uint64_t> voxels;
+  /// classes[l] is the band id of component l; classes[0] is 0.
+  std::vector<uint8_t> classes;
+};
+
+/// labels the connected components of 'in', entirely in memory.  'in' has
+/// size 'dims' and is addressed with element 'strides' (see volume.h).
+/// voxels whose values fall into any of the 'component' bands are
+/// foreground, and connect to neighbors in a band of the same id only; so
+/// one pass labels several classes, with labels unique across all of them.
+/// 'out' is a packed, x-fastest
+/// volume of size 'dims'.  labels are numbered from 1 in order of first
+/// appearance; throws std::overflow_error if they do not fit into an L,
+/// however many threads label it.
+template<typename T, typename L>
+ccom_stats ccom(const T* in, const std::array<uint64_t,3>& dims,
+                const std::array<uint64_t,3>& strides,
+                const std::vector<band<T>>& component, L* out);
+
+/// the same, but 'out' gets the labels as runs (see runs.h), without a dense
+/// label volume ever existing.  only two slices of provisional labels per
+/// thread are kept in memory.
+template<typename T>
+ccom_stats ccom(const T* in, const std::array<uint64_t,3>& dims,
+                const std::array<uint64_t,3>& strides,
+                const std::vector<band<T>>& component, run_volume& out);
+
+/// the same for a bit-packed mask (see bitmask.h): the set voxels are the
+/// foreground.  runs and their overlaps are found a word at a time.
+template<typename L>
+ccom_stats ccom_mask(const uint64_t* mask, const std::array<uint64_t,3>& dims,
+                     L* out);
+ccom_stats ccom_mask(const uint64_t* mask, const std::array<uint64_t,3>& dims,
+                     run_volume& out);
+
+/// file-based interface: everything comes from the config file.  that
+/// gives either one 'component', or classes 'component.<name>' which are
+/// labeled separately in the same pass.  'outclasses' names a text file to
+/// get a "label class-name" line for every component.  'in' is an nhdr or
+/// a TIFF stack (see tiff-stack.h); 'outformat: tiff' writes the labels as
+/// one, which only the single process interface can do.  an nhdr of "type:
+/// bit" is a mask, which needs no 'component'.  'roi: x y z w h d [sx sy
+/// sz]' labels only that region of the input (see volume.h), read in place;
+/// the output nhdr's 'space origin' says where it lies.
 void ccom(const char* fn_config);
+/// the same, but the input is 'in' (see volume-cache.h), whatever the
+/// config's 'in' says.  gives the components' statistics.
+ccom_stats ccom(const char* fn_config, cached_volume& in);
+
+/// labels a time series: the config's 'series' lists one input per
+/// timestep, and '#'s in 'outraw', 'outnhdr' (and 'outindex',
+/// 'outclasses') stand for the timestep, zero padded to their count.  a
+/// timestep's labels are matched up with the previous timestep's slab by
+/// slab, as they are written, rather than in a pass of their own.  if
+/// 'outtracks' names a file (with '#'s, too), every timestep gets a table
+/// with a "label voxels track previous:overlap ..." line per component:
+/// the labels of the previous timestep it overlaps, largest first, and the
+/// track it is on.  a component continues the track of the component it
+/// overlaps most if that one, in turn, overlaps it most; else it starts a
+/// new track.  splits and merges show up as further overlaps.
+void ccom_series(const char* fn_config);
+
+// multi-process labeling.  each of 'nslabs' cooperating processes labels its
+// own z range with ccom_label_slab; once all are done, one process runs
+// ccom_merge; then every slab is rewritten in place by ccom_relabel_slab.  the
+// processes only talk through small files next to the output, so they may
+// run on different nodes with a shared filesystem.  with 'outformat: runs',
+// each slab keeps its runs in a file of its own until it is relabeled.
+void ccom_label_slab(const char* fn_config, size_t slab, size_t nslabs);
+void ccom_merge(const char* fn_config, size_t nslabs);
+void ccom_relabel_slab(const char* fn_config, size_t slab, size_t nslabs);
+
+/// writes the component index (see component-index.h) of a finished output
+/// to 'outindex', if the config names one.  ccom() does this by itself;
+/// after the multi-process phases, it is one more (single process) step.
+void ccom_index(const char* fn_config);
 
 #endif /* TJF_CCOM_H */
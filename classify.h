@@ -0,0 +1,181 @@
+/* Multi-band classification: maps a set of value ranges to small class IDs
+ * in a single pass.  Bands are given as "lo hi id; lo hi id; ...", with
+ * inclusive bounds and ids in [1,255].  Values which fall in no band are
+ * class 0. */
+#ifndef TJF_CLASSIFY_H
+#define TJF_CLASSIFY_H
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+template<typename T> struct band {
+  T lo, hi;
+  uint8_t id;
+};
+
+// the type we read T's values as; 8bit types would otherwise be read as
+// characters, and anything narrower than this would wrap silently.
+template<typename T> struct wide_value {
+  typedef typename std::conditional<std::is_floating_point<T>::value, double,
+    typename std::conditional<std::is_signed<T>::value, int64_t,
+                              uint64_t>::type>::type type;
+};
+
+// reads a value as its wide type.  unsigned types take no negative values
+// (which the stream would wrap around to huge ones).
+template<typename T> typename wide_value<T>::type parse_wide(std::istream& is)
+{
+  typename wide_value<T>::type v;
+  is >> std::ws;
+  if(std::is_unsigned<T>::value && is.peek() == '-') {
+    throw std::invalid_argument("negative value for an unsigned type");
+  }
+  if(!(is >> v)) { throw std::invalid_argument("could not parse value"); }
+  return v;
+}
+
+// reads a T; throws std::invalid_argument if it does not fit.
+template<typename T> T parse_value(std::istream& is) {
+  const typename wide_value<T>::type v = parse_wide<T>(is);
+  if(v < std::numeric_limits<T>::lowest() || v > std::numeric_limits<T>::max())
+  {
+    throw std::invalid_argument("value out of range for the type");
+  }
+  return static_cast<T>(v);
+}
+
+// reads one end of a range.  integer types also take decimals (automatic
+// bounds give those), rounded toward the inside of the range: up for its
+// lower end, down for its upper one.
+template<typename T>
+typename wide_value<T>::type parse_end(std::istream& is, bool upper) {
+  typedef typename wide_value<T>::type W;
+  if(!std::numeric_limits<T>::is_integer) { return parse_wide<T>(is); }
+  std::string token;
+  if(!(is >> token)) { throw std::invalid_argument("could not parse value"); }
+  std::istringstream ts(token);
+  W v;
+  if(token.find_first_of(".eE") == std::string::npos) {
+    v = parse_wide<T>(ts);
+  } else {
+    const double d = parse_wide<double>(ts);
+    if(std::is_unsigned<T>::value && token[0] == '-') {
+      throw std::invalid_argument("negative value for an unsigned type");
+    }
+    const double r = upper ? std::floor(d) : std::ceil(d);
+    v = r <= double(std::numeric_limits<W>::lowest()) ?
+          std::numeric_limits<W>::lowest() :
+        r >= double(std::numeric_limits<W>::max()) ?
+          std::numeric_limits<W>::max() : static_cast<W>(r);
+  }
+  if(!(ts >> std::ws).eof()) {
+    throw std::invalid_argument("could not parse value '" + token + "'");
+  }
+  return v;
+}
+
+// reads the inclusive range "lo hi" of T's.  ends beyond what a T holds are
+// clamped to it; throws std::invalid_argument if the range is empty or no T
+// falls into it.
+template<typename T> std::pair<T,T> parse_range(std::istream& is) {
+  const typename wide_value<T>::type lo = parse_end<T>(is, false);
+  const typename wide_value<T>::type hi = parse_end<T>(is, true);
+  if(hi < lo) { throw std::invalid_argument("empty range"); }
+  const T mn = std::numeric_limits<T>::lowest();
+  const T mx = std::numeric_limits<T>::max();
+  if(hi < mn || lo > mx) {
+    throw std::invalid_argument("range outside the values of the type");
+  }
+  return std::make_pair(lo < mn ? mn : static_cast<T>(lo),
+                        hi > mx ? mx : static_cast<T>(hi));
+}
+
+template<typename T> std::vector<band<T>> parse_bands(std::string spec) {
+  std::vector<band<T>> bands;
+  std::istringstream bs(spec);
+  std::string b;
+  while(std::getline(bs, b, ';')) {
+    if(b.find_first_not_of(" \t\n") == std::string::npos) { continue; }
+    std::istringstream is(b);
+    band<T> bd;
+    const std::pair<T,T> r = parse_range<T>(is);
+    bd.lo = r.first;
+    bd.hi = r.second;
+    const unsigned id = parse_value<unsigned>(is);
+    if(id == 0 || id > 255) {
+      throw std::invalid_argument("class ids must be in [1,255]");
+    }
+    bd.id = static_cast<uint8_t>(id);
+    for(const band<T>& other : bands) {
+      if(!(bd.hi < other.lo || other.hi < bd.lo)) {
+        throw std::invalid_argument("bands overlap");
+      }
+    }
+    bands.push_back(bd);
+  }
+  if(bands.empty()) { throw std::invalid_argument("no bands given"); }
+  return bands;
+}
+
+/// the band spec 'compiled' for fast lookup: a table for 8 and 16 bit
+/// types, else a branchless test of every band (which vectorizes; there
+/// are rarely more than a handful of bands).
+template<typename T> class classifier {
+  public:
+    explicit classifier(const std::vector<band<T>>& bands) {
+      for(const band<T>& b : bands) {
+        lo.push_back(b.lo);
+        hi.push_back(b.hi);
+        id.push_back(b.id);
+      }
+      compile(tabled());
+    }
+
+    // out[i] is the class of in[i].
+    void operator()(const T* in, uint8_t* out, size_t n) const {
+      classify(in, out, n, tabled());
+    }
+
+  private:
+    typedef std::integral_constant<bool,
+      std::is_integral<T>::value && sizeof(T) <= 2> tabled;
+
+    void compile(std::true_type) {
+      const int64_t mn = std::numeric_limits<T>::min();
+      lut.assign(size_t(1) << (8*sizeof(T)), 0);
+      for(size_t b=0; b < id.size(); ++b) {
+        for(int64_t v=lo[b]; v <= hi[b]; ++v) { lut[v-mn] = id[b]; }
+      }
+    }
+    void compile(std::false_type) { }
+
+    void classify(const T* in, uint8_t* out, size_t n, std::true_type) const {
+      const int64_t mn = std::numeric_limits<T>::min();
+      for(size_t i=0; i < n; ++i) { out[i] = lut[int64_t(in[i]) - mn]; }
+    }
+    void classify(const T* in, uint8_t* out, size_t n,
+                  std::false_type) const {
+      for(size_t i=0; i < n; ++i) { out[i] = 0; }
+      // bands are disjoint, so at most one term is nonzero.
+      for(size_t b=0; b < id.size(); ++b) {
+        const T l = lo[b], h = hi[b];
+        const uint8_t c = id[b];
+        for(size_t i=0; i < n; ++i) {
+          out[i] |= uint8_t((l <= in[i]) & (in[i] <= h)) * c;
+        }
+      }
+    }
+
+    std::vector<T> lo, hi;
+    std::vector<uint8_t> id;
+    std::vector<uint8_t> lut;
+};
+
+#endif /* TJF_CLASSIFY_H */
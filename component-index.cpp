@@ -0,0 +1,199 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <unordered_map>
+#include "component-index.h"
+#include "tasks.h"
+
+static const char magic[8] = { 't','j','f','c','i','d','x','\n' };
+
+namespace {
+  // what one chunk of slices knows about a label.
+  struct partial {
+    std::array<uint64_t,3> lo, hi;
+    uint64_t voxels;
+    std::vector<uint64_t> scanlines;
+  };
+  typedef std::unordered_map<uint64_t, partial> partials;
+
+  void add(partials& p, uint64_t label, uint64_t x0, uint64_t n, uint64_t y,
+           uint64_t z, uint64_t scanline) {
+    partials::iterator e = p.find(label);
+    if(e == p.end()) {
+      partial fresh;
+      fresh.lo = {{x0, y, z}};
+      fresh.hi = {{x0+n, y+1, z+1}};
+      fresh.voxels = 0;
+      e = p.insert(std::make_pair(label, fresh)).first;
+    }
+    partial& c = e->second;
+    c.lo[0] = std::min(c.lo[0], x0);
+    c.hi[0] = std::max(c.hi[0], x0+n);
+    c.lo[1] = std::min(c.lo[1], y);
+    c.hi[1] = std::max(c.hi[1], y+1);
+    c.hi[2] = z+1; // slices come in order.
+    c.voxels += n;
+    if(c.scanlines.empty() || c.scanlines.back() != scanline) {
+      c.scanlines.push_back(scanline);
+    }
+  }
+
+  // indexes every chunk of slices in parallel, then stitches the chunks
+  // together in z order.  'each(s, f)' calls f(label, x0, n) for every run
+  // of a label in scanline s.
+  template<typename Each>
+  component_index build(const std::array<uint64_t,3>& dims, Each each) {
+    const uint64_t nchunks = std::max<uint64_t>(1,
+      std::min<uint64_t>(4*tasks::threads(), dims[2]));
+    std::vector<partials> chunks(nchunks);
+    tasks::parallel_for(0, nchunks, 1, [&](uint64_t c0, uint64_t c1) {
+      for(uint64_t c=c0; c < c1; ++c) {
+        const uint64_t z0 = dims[2]*c / nchunks, z1 = dims[2]*(c+1) / nchunks;
+        for(uint64_t z=z0; z < z1; ++z) {
+          for(uint64_t y=0; y < dims[1]; ++y) {
+            const uint64_t s = z*dims[1] + y;
+            each(s, [&](uint64_t label, uint64_t x0, uint64_t n) {
+              add(chunks[c], label, x0, n, y, z, s);
+            });
+          }
+        }
+      }
+    });
+
+    component_index idx;
+    idx.dims = dims;
+    uint64_t components = 0;
+    for(const partials& p : chunks) {
+      for(const auto& e : p) { components = std::max(components, e.first); }
+    }
+    component_entry unused;
+    unused.lo.fill(0);
+    unused.hi.fill(0);
+    unused.voxels = unused.first = unused.count = 0;
+    idx.entries.assign(components, unused);
+    std::vector<bool> seen(components, false);
+    for(const partials& p : chunks) {
+      for(const auto& e : p) {
+        component_entry& c = idx.entries[e.first-1];
+        const partial& q = e.second;
+        if(!seen[e.first-1]) {
+          c.lo = q.lo;
+          c.hi = q.hi;
+          seen[e.first-1] = true;
+        }
+        for(size_t d=0; d < 3; ++d) {
+          c.lo[d] = std::min(c.lo[d], q.lo[d]);
+          c.hi[d] = std::max(c.hi[d], q.hi[d]);
+        }
+        c.voxels += q.voxels;
+        c.count += q.scanlines.size();
+      }
+    }
+    uint64_t total = 0;
+    for(component_entry& c : idx.entries) {
+      c.first = total;
+      total += c.count;
+      c.count = 0;
+    }
+    idx.scanlines.resize(total);
+    for(const partials& p : chunks) {
+      for(const auto& e : p) {
+        component_entry& c = idx.entries[e.first-1];
+        std::copy(e.second.scanlines.begin(), e.second.scanlines.end(),
+                  idx.scanlines.begin() + c.first + c.count);
+        c.count += e.second.scanlines.size();
+      }
+    }
+    return idx;
+  }
+}
+
+template<typename L>
+component_index index_components(const L* labels,
+                                 const std::array<uint64_t,3>& dims)
+{
+  return build(dims, [&](uint64_t s, std::function<void(uint64_t,uint64_t,
+                                                        uint64_t)> f) {
+    const L* row = labels + s*dims[0];
+    for(uint64_t x=0; x < dims[0]; ) {
+      if(row[x] == 0) { ++x; continue; }
+      uint64_t end = x+1;
+      while(end < dims[0] && row[end] == row[x]) { ++end; }
+      f(row[x], x, end-x);
+      x = end;
+    }
+  });
+}
+template component_index index_components(const uint8_t*,
+                                          const std::array<uint64_t,3>&);
+template component_index index_components(const uint16_t*,
+                                          const std::array<uint64_t,3>&);
+template component_index index_components(const uint32_t*,
+                                          const std::array<uint64_t,3>&);
+template component_index index_components(const uint64_t*,
+                                          const std::array<uint64_t,3>&);
+
+component_index index_components(const std::array<uint64_t,3>& dims,
+                                 const uint64_t* index, const run* runs)
+{
+  return build(dims, [&](uint64_t s, std::function<void(uint64_t,uint64_t,
+                                                        uint64_t)> f) {
+    for(const run* r=runs+index[s]; r != runs+index[s+1]; ++r) {
+      f(r->label, r->x, r->n);
+    }
+  });
+}
+
+void write_index(std::string fn, const component_index& idx)
+{
+  std::ofstream ofs(fn.c_str(), std::ios::binary | std::ios::trunc);
+  const uint64_t components = idx.entries.size();
+  const uint64_t nscanlines = idx.scanlines.size();
+  ofs.write(magic, sizeof(magic));
+  ofs.write(reinterpret_cast<const char*>(idx.dims.data()),
+            3*sizeof(uint64_t));
+  ofs.write(reinterpret_cast<const char*>(&components), sizeof(uint64_t));
+  ofs.write(reinterpret_cast<const char*>(&nscanlines), sizeof(uint64_t));
+  ofs.write(reinterpret_cast<const char*>(idx.entries.data()),
+            components*sizeof(component_entry));
+  ofs.write(reinterpret_cast<const char*>(idx.scanlines.data()),
+            nscanlines*sizeof(uint64_t));
+  if(!ofs) { throw std::runtime_error("could not write index " + fn); }
+}
+
+index_file::index_file(std::string fn) : mem(fn.c_str()) {
+  const char* p = static_cast<const char*>(this->mem.map);
+  const size_t header = sizeof(magic) + 5*sizeof(uint64_t);
+  if(!this->mem || this->mem.length < header ||
+     memcmp(p, magic, sizeof(magic)) != 0) {
+    throw std::runtime_error("'" + fn + "' is not an index file");
+  }
+  this->dims_ = reinterpret_cast<const std::array<uint64_t,3>*>(
+    p + sizeof(magic)
+  );
+  this->components_ = reinterpret_cast<const uint64_t*>(
+    p + sizeof(magic) + 3*sizeof(uint64_t)
+  );
+  const uint64_t nscanlines = this->components_[1];
+  this->entries_ = reinterpret_cast<const component_entry*>(p + header);
+  this->scanlines_ = reinterpret_cast<const uint64_t*>(
+    p + header + this->components()*sizeof(component_entry)
+  );
+  if(this->mem.length < header + this->components()*sizeof(component_entry) +
+                        nscanlines*sizeof(uint64_t)) {
+    throw std::runtime_error("'" + fn + "' is truncated");
+  }
+}
+
+const component_entry& index_file::entry(uint64_t label) const {
+  if(label == 0 || label > this->components()) {
+    throw std::out_of_range("no such component");
+  }
+  return this->entries_[label-1];
+}
+
+const uint64_t* index_file::scanlines(uint64_t label) const {
+  return this->scanlines_ + this->entry(label).first;
+}
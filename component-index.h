@@ -0,0 +1,72 @@
+/* An index of the components in a label volume: for every label, its
+ * bounding box, its size and the scanlines it occupies.  With it, one
+ * component can be pulled out of a label volume by touching only the
+ * scanlines it is on, instead of the whole volume.
+ *
+ * On disk, in host byte order:
+ *    "tjfcidx\n"
+ *    dims            3 x uint64
+ *    components      uint64, the number of entries
+ *    nscanlines      uint64
+ *    entries         components x struct component_entry
+ *    scanlines       nscanlines x uint64 */
+#ifndef TJF_COMPONENT_INDEX_H
+#define TJF_COMPONENT_INDEX_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "mmap-memory.h"
+#include "runs.h"
+
+struct component_entry {
+  std::array<uint64_t,3> lo, hi; ///< bounding box, [lo, hi); empty if unused
+  uint64_t voxels;
+  /// the component's scanlines (z*dims[1] + y, ascending) are
+  /// scanlines[first, first+count).
+  uint64_t first, count;
+};
+
+struct component_index {
+  std::array<uint64_t,3> dims;
+  std::vector<component_entry> entries; ///< entries[l-1] describes label l
+  std::vector<uint64_t> scanlines;
+};
+
+/// indexes a packed, x-fastest label volume.  there is an entry for every
+/// label up to the largest one present.
+template<typename L>
+component_index index_components(const L* labels,
+                                 const std::array<uint64_t,3>& dims);
+/// the same, for runs (see runs.h).
+component_index index_components(const std::array<uint64_t,3>& dims,
+                                 const uint64_t* index, const run* runs);
+
+void write_index(std::string fn, const component_index&);
+
+/// read access to an index file, which is mapped rather than read.
+class index_file {
+  public:
+    /// throws std::runtime_error if 'fn' is not a (complete) index file.
+    explicit index_file(std::string fn);
+
+    const std::array<uint64_t,3>& dims() const { return *this->dims_; }
+    uint64_t components() const { return *this->components_; }
+    /// throws std::out_of_range if there is no such label.
+    const component_entry& entry(uint64_t label) const;
+    /// the scanlines of 'label'; there are entry(label).count of them.
+    const uint64_t* scanlines(uint64_t label) const;
+
+  private:
+    index_file(const index_file&) = delete;
+    index_file& operator=(const index_file&) = delete;
+
+    memory mem;
+    const std::array<uint64_t,3>* dims_;
+    const uint64_t* components_;
+    const component_entry* entries_;
+    const uint64_t* scanlines_;
+};
+
+#endif /* TJF_COMPONENT_INDEX_H */
@@ -0,0 +1,329 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <type_traits>
+#include "component-tree.h"
+#include "slab.h"
+#include "tasks.h"
+
+static const char magic[8] = { 't','j','f','c','t','r','e','\n' };
+
+namespace {
+  const uint64_t NONE = std::numeric_limits<uint64_t>::max();
+
+  // voxels [b,e) from the highest value down; equal values in index order.
+  // 8 and 16 bit values are counted rather than compared.
+  template<typename T>
+  std::vector<uint64_t> descending(const T* v, uint64_t b, uint64_t e) {
+    std::vector<uint64_t> order(e-b);
+    if(std::is_integral<T>::value && sizeof(T) <= 2) {
+      const int64_t lo = std::numeric_limits<T>::min();
+      const size_t nvalues = size_t(1) << (8*sizeof(T));
+      std::vector<uint64_t> start(nvalues+1, 0);
+      for(uint64_t p=b; p < e; ++p) {
+        ++start[nvalues-1 - (static_cast<int64_t>(v[p]) - lo) + 1];
+      }
+      std::partial_sum(start.begin(), start.end(), start.begin());
+      for(uint64_t p=b; p < e; ++p) {
+        order[start[nvalues-1 - (static_cast<int64_t>(v[p]) - lo)]++] = p;
+      }
+      return order;
+    }
+    std::iota(order.begin(), order.end(), b);
+    std::sort(order.begin(), order.end(), [v](uint64_t p, uint64_t q) {
+      return v[p] > v[q] || (v[p] == v[q] && p < q);
+    });
+    return order;
+  }
+
+  // NaN is unordered against every value, so it has no level in a tree;
+  // the sorts below would not even be well defined.
+  template<typename T> void reject_nan(const T* in, uint64_t n) {
+    if(!std::is_floating_point<T>::value) { return; }
+    tasks::parallel_for(0, n, 1u << 16, [in](uint64_t b, uint64_t e) {
+      for(uint64_t p=b; p < e; ++p) {
+        if(in[p] != in[p]) {
+          throw std::domain_error("a component tree cannot have NaN levels");
+        }
+      }
+    });
+  }
+
+  // the tree as parent pointers between voxels.  a node is represented by
+  // its canonical voxel, the one whose parent is of a lower level (or
+  // itself, at the root); every other voxel of the node leads to it
+  // through voxels of the same level.
+  template<typename T> struct voxel_tree {
+    voxel_tree(const T* in, const std::array<uint64_t,3>& d) : f(in),
+      dims(d), parent(d[0]*d[1]*d[2]), zpar(parent.size(), NONE),
+      repr(parent.size()), rank(parent.size(), 0) { }
+
+    uint64_t levroot(uint64_t x) const {
+      while(this->parent[x] != x && this->f[this->parent[x]] == this->f[x]) {
+        x = this->parent[x];
+      }
+      return x;
+    }
+    uint64_t find(uint64_t x) {
+      while(this->zpar[x] != x) {
+        this->zpar[x] = this->zpar[this->zpar[x]];
+        x = this->zpar[x];
+      }
+      return x;
+    }
+
+    // Berger's algorithm on slices [z0,z1): voxels join the components of
+    // their neighbors from the highest value down.
+    void slab(uint64_t z0, uint64_t z1) {
+      const uint64_t nx = this->dims[0], ny = this->dims[1], sl = nx*ny;
+      const std::vector<uint64_t> order = descending(this->f, z0*sl, z1*sl);
+      const T* v = this->f;
+      for(const uint64_t p : order) {
+        this->parent[p] = this->zpar[p] = this->repr[p] = p;
+        uint64_t root = p; // of p's set in the forest
+        const uint64_t x = p % nx, y = (p / nx) % ny, z = p / sl;
+        const uint64_t nbrs[6] = {
+          x > 0 ? p-1 : NONE, x+1 < nx ? p+1 : NONE,
+          y > 0 ? p-nx : NONE, y+1 < ny ? p+nx : NONE,
+          z > z0 ? p-sl : NONE, z+1 < z1 ? p+sl : NONE
+        };
+        for(const uint64_t n : nbrs) {
+          if(n == NONE || this->zpar[n] == NONE) { continue; }
+          uint64_t r = this->find(n);
+          if(r == root) { continue; }
+          // the neighbor's component hangs below p; the forest unites by
+          // rank, which keeps finds short.
+          this->parent[this->repr[r]] = p;
+          if(this->rank[r] > this->rank[root]) { std::swap(r, root); }
+          this->zpar[r] = root;
+          if(this->rank[r] == this->rank[root]) { ++this->rank[root]; }
+          this->repr[root] = p;
+        }
+      }
+      // point every voxel at its node's canonical voxel, lowest first.
+      for(auto i=order.rbegin(); i != order.rend(); ++i) {
+        const uint64_t q = this->parent[*i];
+        if(v[this->parent[q]] == v[q]) { this->parent[*i] = this->parent[q]; }
+      }
+    }
+
+    // merges the trees of neighbors 'a' and 'b': at every level up to the
+    // lower of their values, their components are now one.  the two chains
+    // of ancestors are zipped together, highest levels first.
+    void connect(uint64_t a, uint64_t b) {
+      uint64_t x = this->levroot(a), y = this->levroot(b);
+      while(x != NONE && y != NONE && x != y) {
+        if(this->f[x] < this->f[y]) { std::swap(x, y); }
+        const uint64_t z = this->parent[x] == x ? NONE :
+                           this->levroot(this->parent[x]);
+        if(z != NONE && this->f[z] >= this->f[y]) {
+          x = z;
+          continue;
+        }
+        // y belongs between x and its old parent; at the same level, x's
+        // node becomes part of y's.
+        this->parent[x] = y;
+        x = y;
+        y = z;
+      }
+    }
+
+    const T* f;
+    std::array<uint64_t,3> dims;
+    std::vector<uint64_t> parent;
+    // the build's union-find forest; a set's root knows the voxel which
+    // stands for the set's node, and its rank.
+    std::vector<uint64_t> zpar;
+    std::vector<uint64_t> repr;
+    std::vector<uint8_t> rank;
+  };
+}
+
+template<typename T>
+component_tree build_component_tree(const T* in,
+                                    const std::array<uint64_t,3>& dims)
+{
+  component_tree t;
+  t.dims = dims;
+  const uint64_t voxels = dims[0]*dims[1]*dims[2];
+  if(voxels == 0) { return t; }
+  reject_nan(in, voxels);
+
+  voxel_tree<T> vt(in, dims);
+  const size_t nslabs = std::max<uint64_t>(1,
+    std::min<uint64_t>(tasks::threads(), dims[2]));
+  tasks::parallel_for(0, nslabs, 1, [&](uint64_t s0, uint64_t s1) {
+    for(uint64_t s=s0; s < s1; ++s) {
+      const std::pair<uint64_t,uint64_t> zs = slab_range(dims[2], nslabs, s);
+      vt.slab(zs.first, zs.second);
+    }
+  });
+  const uint64_t sl = dims[0]*dims[1];
+  for(size_t s=1; s < nslabs; ++s) {
+    const uint64_t z = slab_range(dims[2], nslabs, s).first;
+    for(uint64_t p=z*sl; p < (z+1)*sl; ++p) { vt.connect(p-sl, p); }
+  }
+
+  // every voxel's canonical voxel; the build's forest is not needed now.
+  std::vector<uint64_t>().swap(vt.repr);
+  std::vector<uint8_t>().swap(vt.rank);
+  std::vector<uint64_t>& canon = vt.zpar;
+  tasks::parallel_for(0, voxels, 1u << 16, [&](uint64_t b, uint64_t e) {
+    for(uint64_t p=b; p < e; ++p) { canon[p] = vt.levroot(p); }
+  });
+  std::vector<uint64_t> reps;
+  for(uint64_t p=0; p < voxels; ++p) {
+    if(canon[p] == p) { reps.push_back(p); }
+  }
+  std::sort(reps.begin(), reps.end(), [in](uint64_t p, uint64_t q) {
+    return in[p] < in[q] || (in[p] == in[q] && p < q);
+  });
+
+  const uint64_t nodes = reps.size();
+  t.parent.resize(nodes);
+  t.level.resize(nodes);
+  for(uint64_t n=0; n < nodes; ++n) {
+    const uint64_t r = reps[n];
+    t.parent[n] = vt.parent[r] == r ? r : vt.levroot(vt.parent[r]);
+    t.level[n] = static_cast<double>(in[r]);
+  }
+  // from here on, 'parent' maps a canonical voxel to its node.
+  std::vector<uint64_t>& id = vt.parent;
+  for(uint64_t n=0; n < nodes; ++n) { id[reps[n]] = n; }
+  for(uint64_t n=0; n < nodes; ++n) { t.parent[n] = id[t.parent[n]]; }
+  t.node.resize(voxels);
+  tasks::parallel_for(0, voxels, 1u << 16, [&](uint64_t b, uint64_t e) {
+    for(uint64_t p=b; p < e; ++p) { t.node[p] = id[canon[p]]; }
+  });
+
+  // attributes: a node's own voxels, then its children's, deepest first.
+  t.area.assign(nodes, 0);
+  t.first.assign(nodes, NONE);
+  for(uint64_t p=0; p < voxels; ++p) {
+    const uint64_t n = t.node[p];
+    if(t.area[n]++ == 0) { t.first[n] = p; }
+  }
+  for(uint64_t n=nodes; n-- > 0; ) {
+    const uint64_t up = t.parent[n];
+    if(up == n) { continue; }
+    t.area[up] += t.area[n];
+    t.first[up] = std::min(t.first[up], t.first[n]);
+  }
+  return t;
+}
+#define TREE(T) \
+  template component_tree build_component_tree(const T*, \
+                                               const std::array<uint64_t,3>&)
+TREE(uint8_t); TREE(uint16_t); TREE(uint32_t); TREE(uint64_t);
+TREE(int8_t); TREE(int16_t); TREE(int32_t); TREE(int64_t);
+TREE(float); TREE(double);
+#undef TREE
+
+void write_tree(std::string fn, const component_tree& t)
+{
+  std::ofstream ofs(fn.c_str(), std::ios::binary | std::ios::trunc);
+  const uint64_t nodes = t.parent.size();
+  const uint64_t idbytes = nodes <= std::numeric_limits<uint32_t>::max() ?
+                           4 : 8;
+  ofs.write(magic, sizeof(magic));
+  ofs.write(reinterpret_cast<const char*>(t.dims.data()), 3*sizeof(uint64_t));
+  ofs.write(reinterpret_cast<const char*>(&nodes), sizeof(uint64_t));
+  ofs.write(reinterpret_cast<const char*>(&idbytes), sizeof(uint64_t));
+  ofs.write(reinterpret_cast<const char*>(t.parent.data()),
+            nodes*sizeof(uint64_t));
+  ofs.write(reinterpret_cast<const char*>(t.level.data()),
+            nodes*sizeof(double));
+  ofs.write(reinterpret_cast<const char*>(t.area.data()),
+            nodes*sizeof(uint64_t));
+  ofs.write(reinterpret_cast<const char*>(t.first.data()),
+            nodes*sizeof(uint64_t));
+  if(idbytes == 8) {
+    ofs.write(reinterpret_cast<const char*>(t.node.data()),
+              t.node.size()*sizeof(uint64_t));
+  } else {
+    std::vector<uint32_t> narrow;
+    for(uint64_t b=0; b < t.node.size(); b += 1u << 20) {
+      const uint64_t e = std::min<uint64_t>(t.node.size(), b + (1u << 20));
+      narrow.assign(t.node.begin()+b, t.node.begin()+e);
+      ofs.write(reinterpret_cast<const char*>(narrow.data()),
+                narrow.size()*sizeof(uint32_t));
+    }
+  }
+  if(!ofs) { throw std::runtime_error("could not write tree " + fn); }
+}
+
+tree_file::tree_file(std::string fn) : mem(fn.c_str()) {
+  const char* p = static_cast<const char*>(this->mem.map);
+  const size_t header = sizeof(magic) + 5*sizeof(uint64_t);
+  if(!this->mem || this->mem.length < header ||
+     memcmp(p, magic, sizeof(magic)) != 0) {
+    throw std::runtime_error("'" + fn + "' is not a tree file");
+  }
+  this->dims_ = reinterpret_cast<const std::array<uint64_t,3>*>(
+    p + sizeof(magic)
+  );
+  this->nodes_ = reinterpret_cast<const uint64_t*>(
+    p + sizeof(magic) + 3*sizeof(uint64_t)
+  );
+  this->idbytes = this->nodes_[1];
+  const uint64_t n = this->nodes();
+  this->parent_ = reinterpret_cast<const uint64_t*>(p + header);
+  this->level_ = reinterpret_cast<const double*>(this->parent_ + n);
+  this->area_ = reinterpret_cast<const uint64_t*>(this->level_ + n);
+  this->first_ = this->area_ + n;
+  this->node_ = this->first_ + n;
+  const uint64_t voxels = this->dims()[0]*this->dims()[1]*this->dims()[2];
+  if((this->idbytes != 4 && this->idbytes != 8) ||
+     this->mem.length < header + 4*n*sizeof(uint64_t) +
+                        voxels*this->idbytes) {
+    throw std::runtime_error("'" + fn + "' is truncated");
+  }
+}
+
+std::vector<uint64_t> components_at(const tree_file& t, double th)
+{
+  // nodes are sorted by level: the ones at or above 'th' are a suffix.
+  uint64_t lo = 0, hi = t.nodes();
+  while(lo < hi) {
+    const uint64_t mid = lo + (hi-lo)/2;
+    if(t.level(mid) < th) { lo = mid+1; } else { hi = mid; }
+  }
+  std::vector<uint64_t> comps;
+  for(uint64_t n=lo; n < t.nodes(); ++n) {
+    if(t.parent(n) == n || t.level(t.parent(n)) < th) { comps.push_back(n); }
+  }
+  std::sort(comps.begin(), comps.end(), [&t](uint64_t a, uint64_t b) {
+    return t.first(a) < t.first(b);
+  });
+  return comps;
+}
+
+template<typename L>
+uint64_t label_at(const tree_file& t, double th, L* out)
+{
+  const std::vector<uint64_t> comps = components_at(t, th);
+  if(comps.size() > std::numeric_limits<L>::max()) {
+    throw std::overflow_error("labels do not fit into the output type");
+  }
+  // every node's label: its component's, found from the parents down.
+  std::vector<L> label(t.nodes(), 0);
+  for(size_t l=0; l < comps.size(); ++l) {
+    label[comps[l]] = static_cast<L>(l+1);
+  }
+  for(uint64_t n=0; n < t.nodes(); ++n) {
+    if(label[n] == 0 && t.level(n) >= th) { label[n] = label[t.parent(n)]; }
+  }
+  const std::array<uint64_t,3>& d = t.dims();
+  tasks::parallel_for(0, d[0]*d[1]*d[2], 1u << 16, [&](uint64_t b,
+                                                       uint64_t e) {
+    for(uint64_t p=b; p < e; ++p) { out[p] = label[t.node(p)]; }
+  });
+  return comps.size();
+}
+template uint64_t label_at(const tree_file&, double, uint8_t*);
+template uint64_t label_at(const tree_file&, double, uint16_t*);
+template uint64_t label_at(const tree_file&, double, uint32_t*);
+template uint64_t label_at(const tree_file&, double, uint64_t*);
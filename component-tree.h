@@ -0,0 +1,95 @@
+/* The component tree (max-tree) of a volume: every connected component of
+ * every upper level set {v >= t}, as a tree.  A node is a component at its
+ * own level; its parent is the component it lies within at the next lower
+ * level present.  Voxels connect to their 6 neighbors, just as in ccom.
+ *
+ * Built once, the tree answers "what are the components at threshold t" for
+ * any t without looking at a voxel, and a label volume for t is one lookup
+ * per voxel.  Labels are numbered in order of first appearance, so they are
+ * the very labels ccom gives for 'component: { range t <above max> }'.
+ *
+ * The build sorts and links each z slab in parallel (Berger's union-find
+ * max-tree), then merges the slabs' trees along their faces.
+ *
+ * On disk, in host byte order:
+ *    "tjfctre\n"
+ *    dims            3 x uint64
+ *    nodes           uint64
+ *    idbytes         uint64, 4 or 8: the width of a voxel's node id
+ *    parent          nodes x uint64; the root is its own parent
+ *    level           nodes x double
+ *    area            nodes x uint64, voxels in the node's component
+ *    first           nodes x uint64, the component's first voxel
+ *    node            voxels x idbytes, every voxel's node
+ * Nodes are sorted by level, so parents come before their children. */
+#ifndef TJF_COMPONENT_TREE_H
+#define TJF_COMPONENT_TREE_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "mmap-memory.h"
+
+struct component_tree {
+  std::array<uint64_t,3> dims;
+  std::vector<uint64_t> parent;
+  std::vector<double> level;
+  std::vector<uint64_t> area;
+  std::vector<uint64_t> first;
+  std::vector<uint64_t> node; ///< per voxel, x-fastest
+};
+
+/// the tree of the packed, x-fastest volume 'in'.  levels are kept as
+/// doubles, so 64 bit integers beyond 2^53 may round.  throws
+/// std::domain_error if a value is NaN.
+template<typename T>
+component_tree build_component_tree(const T* in,
+                                    const std::array<uint64_t,3>& dims);
+
+void write_tree(std::string fn, const component_tree&);
+
+/// read access to a tree file, which is mapped rather than read.
+class tree_file {
+  public:
+    /// throws std::runtime_error if 'fn' is not a (complete) tree file.
+    explicit tree_file(std::string fn);
+
+    const std::array<uint64_t,3>& dims() const { return *this->dims_; }
+    uint64_t nodes() const { return *this->nodes_; }
+    uint64_t parent(uint64_t n) const { return this->parent_[n]; }
+    double level(uint64_t n) const { return this->level_[n]; }
+    uint64_t area(uint64_t n) const { return this->area_[n]; }
+    uint64_t first(uint64_t n) const { return this->first_[n]; }
+    uint64_t node(uint64_t voxel) const {
+      return this->idbytes == 4 ?
+        static_cast<const uint32_t*>(this->node_)[voxel] :
+        static_cast<const uint64_t*>(this->node_)[voxel];
+    }
+
+  private:
+    tree_file(const tree_file&) = delete;
+    tree_file& operator=(const tree_file&) = delete;
+
+    memory mem;
+    const std::array<uint64_t,3>* dims_;
+    const uint64_t* nodes_;
+    uint64_t idbytes;
+    const uint64_t* parent_;
+    const double* level_;
+    const uint64_t* area_;
+    const uint64_t* first_;
+    const void* node_;
+};
+
+/// the components of {v >= t}: their nodes, in label order (label l is
+/// element l-1).  a node's area is its component's size.
+std::vector<uint64_t> components_at(const tree_file&, double t);
+
+/// writes the labels of {v >= t} to the packed, x-fastest volume 'out', in
+/// parallel.  gives the number of components; throws std::overflow_error
+/// if they do not fit into an L.
+template<typename L>
+uint64_t label_at(const tree_file&, double t, L* out);
+
+#endif /* TJF_COMPONENT_TREE_H */
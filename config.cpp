@@ -14,6 +14,7 @@ config::config(std::string file, const char delim) :
 std::string config::value(std::string key) {
   std::istream& hdr(*this->cfg);
 
+  hdr.clear(); // a previous, failed lookup leaves us at EOF.
   hdr.seekg(0);
   std::string k;
   do {
@@ -29,3 +30,25 @@ std::string config::value(std::string key) {
   throw std::runtime_error("key not found");
 }
 
+std::string config::value(std::string key, std::string dflt) {
+  try {
+    return this->value(key);
+  } catch(const std::runtime_error&) {
+    return dflt;
+  }
+}
+
+std::vector<std::string> config::keys() {
+  std::istream& hdr(*this->cfg);
+
+  hdr.clear();
+  hdr.seekg(0);
+  std::vector<std::string> ks;
+  char buffer[512];
+  while(hdr.getline(buffer, 512, this->delimiter)) {
+    const std::string k = trim(std::string(buffer));
+    if(!k.empty()) { ks.push_back(k); }
+    hdr.getline(buffer, 512);
+  }
+  return ks;
+}
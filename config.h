@@ -3,6 +3,7 @@
 
 #include <fstream>
 #include <memory>
+#include <vector>
 #include "nonstd.h"
 
 class config {
@@ -13,6 +14,10 @@ class config {
     virtual ~config();
 
     virtual std::string value(std::string key);
+    /// like above, but gives 'dflt' instead of throwing if 'key' is missing
+    virtual std::string value(std::string key, std::string dflt);
+    /// every key in the file, in order.
+    virtual std::vector<std::string> keys();
 
   private:
     std::unique_ptr<std::ifstream, nonstd::stream_deleter> cfg;
@@ -1,37 +1,83 @@
-#include <algorithm>
-#include <cassert>
-#include <cerrno>
 #include <cstdlib>
 #include <cstring>
-#include <fcntl.h>
-#include <fstream>
+#include <functional>
 #include <iostream>
-#include <memory>
-#include <set>
-#include <sstream>
 #include <stdexcept>
-#include <sys/stat.h>
 #include <sys/types.h>
-#include <utility>
-
-#include <libgen.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include "ccom.h"
-#include "f-nrrd.h"
-#include "sutil.h"
 
-struct array_deleter {
-  template<typename T> void operator()(T* t) const { delete[] t; }
-};
+static void usage(const char* argv0)
+{
+  std::cerr << "Usage: " << argv0 << " configfile\n"
+            << "       " << argv0 << " configfile label <slab> <nslabs>\n"
+            << "       " << argv0 << " configfile merge <nslabs>\n"
+            << "       " << argv0 << " configfile relabel <slab> <nslabs>\n"
+            << "       " << argv0 << " configfile index\n"
+            << "       " << argv0 << " configfile series\n"
+            << "       " << argv0 << " configfile fork <nslabs>\n";
+}
+
+// runs 'f(i)' for i in [0,n), each in its own child process.
+static void forked(size_t n, std::function<void(size_t)> f)
+{
+  for(size_t i=0; i < n; ++i) {
+    const pid_t pid = fork();
+    if(pid == -1) { throw std::runtime_error("fork failed"); }
+    if(pid == 0) {
+      try {
+        f(i);
+      } catch(const std::exception& e) {
+        std::cerr << "slab " << i << ": " << e.what() << "\n";
+        _exit(EXIT_FAILURE);
+      }
+      _exit(EXIT_SUCCESS);
+    }
+  }
+  bool ok = true;
+  for(size_t i=0; i < n; ++i) {
+    int status;
+    if(wait(&status) == -1 || !WIFEXITED(status) ||
+       WEXITSTATUS(status) != EXIT_SUCCESS) {
+      ok = false;
+    }
+  }
+  if(!ok) { throw std::runtime_error("a slab process failed"); }
+}
 
 int main(int argc, char* argv[])
 {
-  if(argc != 2) {
-    std::cerr << "Usage: " << argv[0] << "configfile\n";
+  if(argc < 2) {
+    usage(argv[0]);
     return EXIT_FAILURE;
   }
+  const char* cfg = argv[1];
 
-  ccom(argv[1]);
+  if(argc == 2) {
+    ccom(cfg);
+  } else if(argc == 5 && strcmp(argv[2], "label") == 0) {
+    ccom_label_slab(cfg, atoi(argv[3]), atoi(argv[4]));
+  } else if(argc == 4 && strcmp(argv[2], "merge") == 0) {
+    ccom_merge(cfg, atoi(argv[3]));
+  } else if(argc == 5 && strcmp(argv[2], "relabel") == 0) {
+    ccom_relabel_slab(cfg, atoi(argv[3]), atoi(argv[4]));
+  } else if(argc == 3 && strcmp(argv[2], "index") == 0) {
+    ccom_index(cfg);
+  } else if(argc == 3 && strcmp(argv[2], "series") == 0) {
+    ccom_series(cfg);
+  } else if(argc == 4 && strcmp(argv[2], "fork") == 0) {
+    // all phases, with local processes.  mostly useful for testing.
+    const size_t n = atoi(argv[3]);
+    forked(n, [=](size_t i) { ccom_label_slab(cfg, i, n); });
+    ccom_merge(cfg, n);
+    forked(n, [=](size_t i) { ccom_relabel_slab(cfg, i, n); });
+    ccom_index(cfg);
+  } else {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
 
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,131 @@
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include "component-tree.h"
+#include "f-nrrd.h"
+#include "mmap-memory.h"
+
+namespace {
+  template<typename T> component_tree build_t(const memory& in,
+                                              const std::array<uint64_t,3>& d) {
+    return build_component_tree(static_cast<const T*>(in.map), d);
+  }
+
+  component_tree build(const char* fn) {
+    const nrrd n(fn);
+    const std::array<uint64_t,3> d = n.dimensions();
+    if(d[0]*d[1]*d[2] == 0) {
+      component_tree t;
+      t.dims = d;
+      return t;
+    }
+    if(n.datatype() == nrrd::BIT) {
+      throw std::domain_error("a mask has no levels to build a tree of");
+    }
+    const memory in(n.datafile().c_str());
+    if(!in || in.length < d[0]*d[1]*d[2]*nrrd::bytes(n.datatype())) {
+      throw std::runtime_error("cannot read '" + n.datafile() + "'");
+    }
+    switch(n.datatype()) {
+      case nrrd:: UINT8: return build_t< uint8_t>(in, d);
+      case nrrd::UINT16: return build_t<uint16_t>(in, d);
+      case nrrd::UINT32: return build_t<uint32_t>(in, d);
+      case nrrd::UINT64: return build_t<uint64_t>(in, d);
+      case nrrd:: INT8: return build_t< int8_t>(in, d);
+      case nrrd::INT16: return build_t<int16_t>(in, d);
+      case nrrd::INT32: return build_t<int32_t>(in, d);
+      case nrrd::INT64: return build_t<int64_t>(in, d);
+      case nrrd::FLOAT: return build_t<float>(in, d);
+      case nrrd::DOUBLE: return build_t<double>(in, d);
+      default: throw std::domain_error("unknown type");
+    }
+  }
+
+  void label(const tree_file& t, double th, const char* rawfn,
+             const char* nhdr, const char* type) {
+    const uint64_t components = components_at(t, th).size();
+    nrrd::dtype ltype = nrrd::unsigned_type(components);
+    if(type) {
+      const char* types[] = { "uint8", "uint16", "uint32", "uint64" };
+      const nrrd::dtype dtypes[] = {
+        nrrd::UINT8, nrrd::UINT16, nrrd::UINT32, nrrd::UINT64
+      };
+      size_t i = 0;
+      while(i < 4 && strcmp(type, types[i]) != 0) { ++i; }
+      if(i == 4) {
+        throw std::invalid_argument("type must be uint8, uint16, uint32 or "
+                                    "uint64");
+      }
+      ltype = dtypes[i];
+    }
+    const std::array<uint64_t,3>& d = t.dims();
+    const uint64_t voxels = d[0]*d[1]*d[2];
+    nrrd::write_header(nhdr, d, ltype, rawfn);
+    // start from an empty file; mapping a stale, longer one would keep its
+    // tail.
+    std::ofstream(rawfn, std::ios::binary | std::ios::trunc).close();
+    std::clog << components << " components.\n";
+    if(voxels == 0) { return; }
+    memory out(rawfn, voxels * nrrd::bytes(ltype));
+    if(!out) {
+      throw std::runtime_error(std::string("could not create '") + rawfn +
+                               "'");
+    }
+    switch(ltype) {
+      case nrrd::UINT8: label_at(t, th, static_cast<uint8_t*>(out.map)); break;
+      case nrrd::UINT16:
+        label_at(t, th, static_cast<uint16_t*>(out.map)); break;
+      case nrrd::UINT32:
+        label_at(t, th, static_cast<uint32_t*>(out.map)); break;
+      default: label_at(t, th, static_cast<uint64_t*>(out.map)); break;
+    }
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  const bool build_cmd = argc == 4 && strcmp(argv[1], "build") == 0;
+  const bool comps_cmd = argc == 4 && strcmp(argv[1], "components") == 0;
+  const bool label_cmd = (argc == 6 || argc == 7) &&
+                         strcmp(argv[1], "label") == 0;
+  if(!build_cmd && !comps_cmd && !label_cmd) {
+    std::cerr << "Usage: " << argv[0] << " build in-nhdr tree\n"
+              << "       " << argv[0] << " components tree threshold\n"
+              << "       " << argv[0] << " label tree threshold out-raw "
+              << "out-nhdr [uint8|uint16|uint32|uint64]\n"
+              << "  'build' computes the component tree of a volume once; "
+              << "after that, the\n  components of {value >= threshold} "
+              << "come straight from the tree.\n"
+              << "  'components' lists them as \"label voxels level\" "
+              << "lines; 'label' writes\n  their label volume, as ccom "
+              << "would.\n";
+    return EXIT_FAILURE;
+  }
+
+  try {
+    if(build_cmd) {
+      const component_tree t = build(argv[2]);
+      std::clog << t.parent.size() << " nodes.\n";
+      write_tree(argv[3], t);
+      return EXIT_SUCCESS;
+    }
+    const tree_file t(argv[2]);
+    const double th = std::strtod(argv[3], NULL);
+    if(comps_cmd) {
+      const std::vector<uint64_t> comps = components_at(t, th);
+      for(size_t l=0; l < comps.size(); ++l) {
+        std::cout << l+1 << " " << t.area(comps[l]) << " "
+                  << t.level(comps[l]) << "\n";
+      }
+      return EXIT_SUCCESS;
+    }
+    label(t, th, argv[4], argv[5], argc > 6 ? argv[6] : NULL);
+  } catch(const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -1,77 +1,66 @@
-#include <algorithm>
-#include <iterator>
 #include <iostream>
-#include <list>
-#include <set>
-#include <stdexcept>
+#include <map>
+#include <numeric>
+#include <vector>
 #include "disjointset.h"
 
 struct dset_impl {
   dset_impl() { }
 
-  void unio(int a, int b) {
-    // search for the set with 'a' in it.
-    auto it = findset(a);
-    // did we find such a set?  if not, let's search for 'b'.
-    if(it == sets.end()) {
-      it = findset(b);
-    }
-    // did we *still* not find anything?!
-    if(it == sets.end()) {
-      // then we need to add a completely new set.
-      std::set<int> newset;
-      newset.insert(a);
-      newset.insert(b);
-      this->sets.push_front(newset);
+  void unio(uint64_t a, uint64_t b) {
+    const uint64_t ra = find(a);
+    const uint64_t rb = find(b);
+    // what's the 'canonical value' for a set of values?  it is arbitrary,
+    // and really doesn't matter as long as we are consistent.  we choose the
+    // minimum element in the set, which falls out of always hanging the
+    // larger root underneath the smaller one.
+    if(ra < rb) {
+      parent[rb] = ra;
     } else {
-      // or we need to add in our elements to the set we found.
-      // we don't know which set this is, though -- i.e. did we
-      // grab the set with 'a' in it or the set with 'b' in it?
-      // fortunately sets are smart and duplicate entries are just
-      // discarded, so we'll just throw in both and that'll cover
-      // it.
-      it->insert(a);
-      it->insert(b);
+      parent[ra] = rb;
     }
   }
-  int find(int a) {
-    // find which set this value is in.
-    auto it = findset(a);
-    // ... or maybe we found nothing at all?
-    if(it == sets.end()) { throw std::runtime_error("set not found!"); }
-    // what's the 'canonical value' for a set of values?  it is
-    // arbitrary, and really doesn't matter as long as we are
-    // consistent.  we choose the minimum element in the set for
-    // now.
-    auto m = std::min_element(it->begin(), it->end());
-    return *m;
+  uint64_t find(uint64_t a) {
+    grow(a);
+    uint64_t root = a;
+    while(parent[root] != root) { root = parent[root]; }
+    // path compression: point everything we walked over straight at the root
+    while(parent[a] != root) {
+      const uint64_t next = parent[a];
+      parent[a] = root;
+      a = next;
+    }
+    return root;
   }
 
-  // identifies the set which has 'a' in it.  will be sets::end()
-  // if such a set was not found.
-  std::list<std::set<int>>::iterator findset(int a) {
-    return std::find_if(sets.begin(), sets.end(),
-                        [=](const std::set<int>& s) -> bool {
-                          return s.find(a) != s.end();
-                        });
+  // makes sure 'a' is a valid index; new elements are their own sets.
+  void grow(uint64_t a) {
+    if(a < parent.size()) { return; }
+    const uint64_t old = parent.size();
+    parent.resize(a+1);
+    std::iota(parent.begin()+old, parent.end(), old);
   }
 
   // for debugging
   void print() {
-    for(const std::set<int>& s : sets) {
-      std::copy(s.begin(), s.end(),
-                std::ostream_iterator<int>(std::clog, " "));
+    std::map<uint64_t, std::vector<uint64_t>> sets;
+    for(uint64_t i=0; i < parent.size(); ++i) {
+      sets[find(i)].push_back(i);
+    }
+    for(const auto& s : sets) {
+      for(uint64_t v : s.second) { std::clog << v << " "; }
       std::clog << "\n";
     }
   }
 
-  std::list<std::set<int>> sets;
+  std::vector<uint64_t> parent;
 };
 
 DisjointSet::DisjointSet() : impl(new dset_impl()) { }
 DisjointSet::~DisjointSet() = default;
 // unions the two elements 'a' and 'b'
-void DisjointSet::unio(int a, int b) { this->impl->unio(a,b); }
+void DisjointSet::unio(uint64_t a, uint64_t b) { this->impl->unio(a,b); }
 // of the set which 'a' is a part of, returns the minimum value.
-int DisjointSet::find(int a) { return this->impl->find(a); }
+uint64_t DisjointSet::find(uint64_t a) { return this->impl->find(a); }
+uint64_t DisjointSet::size() const { return this->impl->parent.size(); }
 void DisjointSet::print() { this->impl->print(); }
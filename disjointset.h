@@ -1,19 +1,23 @@
 #ifndef TJF_DISJOINT_SET_H
 #define TJF_DISJOINT_SET_H
 
+#include <cstdint>
 #include <memory>
 
 struct dset_impl;
 
-/** hacky/quick disjoint set. */
+/** union-find over non-negative integers.  elements spring into existence
+ * (as singletons) the first time they are mentioned. */
 class DisjointSet {
   public:
     DisjointSet();
     ~DisjointSet();
     // unions the two elements 'a' and 'b'
-    void unio(int a, int b);
+    void unio(uint64_t a, uint64_t b);
     // of the set which 'a' is a part of, returns the minimum value.
-    int find(int a);
+    uint64_t find(uint64_t a);
+    // one past the largest element we've seen.
+    uint64_t size() const;
 
     void print(); // debugging
 
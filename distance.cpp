@@ -0,0 +1,138 @@
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <omp.h>
+#include <stdexcept>
+#include <vector>
+#include "distance.h"
+
+namespace {
+  const double inf = std::numeric_limits<double>::infinity();
+
+  // 1D squared distance transform of the sampled function 'f': the lower
+  // envelope of the parabolas rooted at each sample.  'v' and 'z' are
+  // scratch space for the envelope's parabolas and their boundaries.
+  void dt1d(const double* f, double* d, int64_t n, std::vector<int64_t>& v,
+            std::vector<double>& z) {
+    v.resize(n);
+    z.resize(n+1);
+    int64_t k = 0;
+    // skip leading samples which are infinitely far away; they never
+    // contribute to the envelope.
+    int64_t q = 0;
+    while(q < n && f[q] == inf) { ++q; }
+    if(q == n) { // nothing to measure from.
+      for(int64_t i=0; i < n; ++i) { d[i] = inf; }
+      return;
+    }
+    v[0] = q;
+    z[0] = -inf;
+    z[1] = inf;
+    // where the parabolas rooted at 'a' and 'b' intersect.
+    auto intersect = [&](int64_t a, int64_t b) {
+      return ((f[a] + double(a)*a) - (f[b] + double(b)*b)) / (2.0*(a - b));
+    };
+    for(++q; q < n; ++q) {
+      if(f[q] == inf) { continue; }
+      double s = intersect(q, v[k]);
+      while(s <= z[k]) { // z[0] is -inf, so this stops at k == 0.
+        --k;
+        s = intersect(q, v[k]);
+      }
+      ++k;
+      v[k] = q;
+      z[k] = s;
+      z[k+1] = inf;
+    }
+    k = 0;
+    for(int64_t i=0; i < n; ++i) {
+      while(z[k+1] < i) { ++k; }
+      const double dx = double(i) - v[k];
+      d[i] = dx*dx + f[v[k]];
+    }
+  }
+
+  uint32_t clamp(double v) {
+    return v >= double(EDT_INFINITY) ? EDT_INFINITY : static_cast<uint32_t>(v);
+  }
+
+  // transforms every line along 'axis' of 'io'.  on the first pass the
+  // input is the inside/outside mask instead.
+  template<typename T>
+  void pass(const T* in, int64_t label, uint32_t* io,
+            const std::array<uint64_t,3>& dims, size_t axis) {
+    const std::array<uint64_t,3> stride = {{1, dims[0], dims[0]*dims[1]}};
+    const size_t a = (axis+1) % 3, b = (axis+2) % 3;
+    const int64_t n = dims[axis];
+    const int64_t lines = dims[a]*dims[b];
+    #pragma omp parallel
+    {
+      std::vector<double> f(n), d(n), z;
+      std::vector<int64_t> v;
+      #pragma omp for schedule(static)
+      for(int64_t l=0; l < lines; ++l) {
+        const uint64_t start = (l % dims[a])*stride[a] +
+                               (l / dims[a])*stride[b];
+        for(int64_t i=0; i < n; ++i) {
+          const uint64_t idx = start + i*stride[axis];
+          if(in != NULL) {
+            const bool inside = label < 0 ? in[idx] != 0 :
+                                            in[idx] == static_cast<T>(label);
+            f[i] = inside ? inf : 0.0;
+          } else {
+            f[i] = io[idx] == EDT_INFINITY ? inf : double(io[idx]);
+          }
+        }
+        dt1d(f.data(), d.data(), n, v, z);
+        for(int64_t i=0; i < n; ++i) {
+          io[start + i*stride[axis]] = clamp(d[i]);
+        }
+      }
+    }
+  }
+
+  template<typename T>
+  void edt(const void* in, const std::array<uint64_t,3>& dims, int64_t label,
+           uint32_t* out) {
+    // a label T cannot hold would be truncated to some other one.
+    if(label >= 0 && double(label) > double(std::numeric_limits<T>::max())) {
+      throw std::out_of_range("label outside the values of the input type");
+    }
+    if(dims[0]*dims[1]*dims[2] == 0) { return; }
+    pass(static_cast<const T*>(in), label, out, dims, 0);
+    pass<T>(NULL, label, out, dims, 1);
+    pass<T>(NULL, label, out, dims, 2);
+  }
+}
+
+void squared_edt(const void* in, nrrd::dtype t,
+                 const std::array<uint64_t,3>& dims, int64_t label,
+                 uint32_t* out)
+{
+  switch(t) {
+    case nrrd:: UINT8: edt< uint8_t>(in, dims, label, out); break;
+    case nrrd::UINT16: edt<uint16_t>(in, dims, label, out); break;
+    case nrrd::UINT32: edt<uint32_t>(in, dims, label, out); break;
+    case nrrd::UINT64: edt<uint64_t>(in, dims, label, out); break;
+    case nrrd:: INT8: edt< int8_t>(in, dims, label, out); break;
+    case nrrd::INT16: edt<int16_t>(in, dims, label, out); break;
+    case nrrd::INT32: edt<int32_t>(in, dims, label, out); break;
+    case nrrd::INT64: edt<int64_t>(in, dims, label, out); break;
+    case nrrd::FLOAT: edt<float>(in, dims, label, out); break;
+    case nrrd::DOUBLE: edt<double>(in, dims, label, out); break;
+    case nrrd::BIT: throw std::domain_error("bit masks are not supported");
+  }
+}
+
+void edt_sqrt(uint32_t* d, uint64_t n)
+{
+  static_assert(sizeof(float) == sizeof(uint32_t), "in place needs 4 bytes");
+  const int64_t sn = n;
+  #pragma omp parallel for schedule(static)
+  for(int64_t i=0; i < sn; ++i) {
+    const float f = d[i] == EDT_INFINITY ?
+                    std::numeric_limits<float>::infinity() :
+                    std::sqrt(static_cast<float>(d[i]));
+    std::memcpy(d+i, &f, sizeof(float));
+  }
+}
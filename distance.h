@@ -0,0 +1,24 @@
+/* Exact Euclidean distance transform, via the separable linear-time
+ * algorithm of Felzenszwalb and Huttenlocher: a 1D transform of squared
+ * distances along x, then along y on that result, then along z. */
+#ifndef TJF_DISTANCE_H
+#define TJF_DISTANCE_H
+
+#include <array>
+#include <cstdint>
+#include "f-nrrd.h"
+
+/// squared distance of voxels which cannot reach the outside at all.
+const uint32_t EDT_INFINITY = UINT32_MAX;
+
+/// squared distance from every 'inside' voxel of 'in' to the nearest voxel
+/// which is not inside; outside voxels get 0.  inside means nonzero or, if
+/// 'label' is not negative, equal to 'label'; throws std::out_of_range if
+/// the input type cannot hold it.  'out' holds a value for every voxel.
+void squared_edt(const void* in, nrrd::dtype, const std::array<uint64_t,3>&,
+                 int64_t label, uint32_t* out);
+
+/// replaces the squared distances in 'd' by distances, in place.
+void edt_sqrt(uint32_t* d, uint64_t n);
+
+#endif /* TJF_DISTANCE_H */
@@ -0,0 +1,61 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iostream>
+
+#include "distance.h"
+#include "f-nrrd.h"
+#include "mmap-memory.h"
+
+int main(int argc, char* argv[])
+{
+  if(argc < 4 || argc > 6) {
+    std::cerr << "Usage: " << argv[0]
+              << " in-nhdr out-raw out-nhdr [float|squared] [label]\n"
+              << "  float: distances as floats (default)\n"
+              << "  squared: squared distances as uint32\n"
+              << "  label: only measure inside voxels with this value, "
+              << "instead of all nonzero voxels\n";
+    return EXIT_FAILURE;
+  }
+  const bool squared = argc > 4 && strcmp(argv[4], "squared") == 0;
+  if(argc > 4 && !squared && strcmp(argv[4], "float") != 0) {
+    std::cerr << "output must be 'float' or 'squared'\n";
+    return EXIT_FAILURE;
+  }
+  const int64_t label = argc > 5 ? std::strtoll(argv[5], NULL, 10) : -1;
+
+  nrrd n(argv[1]);
+  const std::array<uint64_t,3> dims = n.dimensions();
+  const uint64_t voxels = dims[0]*dims[1]*dims[2];
+  nrrd::write_header(argv[3], dims, squared ? nrrd::UINT32 : nrrd::FLOAT,
+                     argv[2]);
+  // start from an empty file; mapping a stale, longer one would keep its tail.
+  std::ofstream(argv[2], std::ios::binary | std::ios::trunc).close();
+  if(voxels == 0) { return EXIT_SUCCESS; }
+
+  memory in(n.datafile().c_str());
+  if(!in || in.length < voxels * nrrd::bytes(n.datatype())) {
+    std::cerr << "Cannot read " << n.datafile() << "\n";
+    return EXIT_FAILURE;
+  }
+  // both outputs are 4 bytes per voxel, so floats are converted in place.
+  memory out(argv[2], voxels * sizeof(uint32_t));
+  if(!out) {
+    std::cerr << "Could not create '" << argv[2] << "'\n";
+    return EXIT_FAILURE;
+  }
+  uint32_t* d = static_cast<uint32_t*>(out.map);
+  try {
+    squared_edt(in.map, n.datatype(), dims, label, d);
+  } catch(const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    remove(argv[2]);
+    remove(argv[3]);
+    return EXIT_FAILURE;
+  }
+  if(!squared) { edt_sqrt(d, voxels); }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,64 @@
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "f-nrrd.h"
+#include "mmap-memory.h"
+#include "runs.h"
+
+namespace {
+  template<typename L> void expand_to(const run_file& r, void* out) {
+    r.expand(static_cast<L*>(out));
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  if(argc < 4 || argc > 5) {
+    std::cerr << "Usage: " << argv[0]
+              << " in-runs out-raw out-nhdr [uint8|uint16|uint32|uint64]\n"
+              << "  expands a runs file (ccom's 'outformat: runs') into a "
+              << "raw label volume.\n"
+              << "  the default type is the narrowest one which fits.\n";
+    return EXIT_FAILURE;
+  }
+
+  const run_file r(argv[1]);
+  nrrd::dtype type = nrrd::UINT64;
+  if(argc > 4) {
+    const char* types[] = { "uint8", "uint16", "uint32", "uint64" };
+    const nrrd::dtype dtypes[] = {
+      nrrd::UINT8, nrrd::UINT16, nrrd::UINT32, nrrd::UINT64
+    };
+    size_t t = 0;
+    while(t < 4 && strcmp(argv[4], types[t]) != 0) { ++t; }
+    if(t == 4) {
+      std::cerr << "type must be uint8, uint16, uint32 or uint64\n";
+      return EXIT_FAILURE;
+    }
+    type = dtypes[t];
+  } else {
+    type = nrrd::unsigned_type(r.components());
+  }
+
+  const std::array<uint64_t,3> dims = r.dims();
+  const uint64_t voxels = dims[0]*dims[1]*dims[2];
+  nrrd::write_header(argv[3], dims, type, argv[2]);
+  // start from an empty file; mapping a stale, longer one would keep its tail.
+  std::ofstream(argv[2], std::ios::binary | std::ios::trunc).close();
+  if(voxels == 0) { return EXIT_SUCCESS; }
+
+  memory out(argv[2], voxels * nrrd::bytes(type));
+  if(!out) {
+    std::cerr << "Could not create '" << argv[2] << "'\n";
+    return EXIT_FAILURE;
+  }
+  switch(type) {
+    case nrrd::UINT8: expand_to<uint8_t>(r, out.map); break;
+    case nrrd::UINT16: expand_to<uint16_t>(r, out.map); break;
+    case nrrd::UINT32: expand_to<uint32_t>(r, out.map); break;
+    default: expand_to<uint64_t>(r, out.map); break;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,172 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "component-index.h"
+#include "f-nrrd.h"
+#include "mmap-memory.h"
+#include "runs.h"
+
+namespace {
+  // reads pieces of scanlines out of a label volume, whichever its format.
+  struct labels {
+    virtual ~labels() {}
+    /// labels [x0,x1) of scanline 's' into 'out'.
+    virtual void read(uint64_t s, uint64_t x0, uint64_t x1,
+                      uint64_t* out) const = 0;
+    virtual nrrd::dtype type() const = 0;
+  };
+
+  template<typename L> struct raw_labels : public labels {
+    raw_labels(const nrrd& n, const std::array<uint64_t,3>& d) :
+      mem(n.datafile().c_str()), dims(d), t(n.datatype()) {
+      if(!mem || mem.length < d[0]*d[1]*d[2]*sizeof(L)) {
+        throw std::runtime_error("cannot read '" + n.datafile() + "'");
+      }
+    }
+    void read(uint64_t s, uint64_t x0, uint64_t x1, uint64_t* out) const {
+      const L* row = static_cast<const L*>(this->mem.map) + s*this->dims[0];
+      std::copy(row+x0, row+x1, out);
+    }
+    nrrd::dtype type() const { return this->t; }
+
+    memory mem;
+    std::array<uint64_t,3> dims;
+    nrrd::dtype t;
+  };
+
+  struct run_labels : public labels {
+    explicit run_labels(std::string fn) : r(fn) {}
+    void read(uint64_t s, uint64_t x0, uint64_t x1, uint64_t* out) const {
+      std::fill(out, out + (x1-x0), 0);
+      const run* end = this->r.runs() + this->r.index()[s+1];
+      for(const run* i=this->r.runs() + this->r.index()[s]; i != end; ++i) {
+        const uint64_t b = std::max<uint64_t>(i->x, x0);
+        const uint64_t e = std::min<uint64_t>(i->x + i->n, x1);
+        if(b < e) { std::fill(out + (b-x0), out + (e-x0), i->label); }
+      }
+    }
+    nrrd::dtype type() const {
+      return nrrd::unsigned_type(this->r.components());
+    }
+    run_file r;
+  };
+
+  std::unique_ptr<labels> open_labels(std::string fn,
+                                      const std::array<uint64_t,3>& dims) {
+    if(is_run_file(fn)) {
+      std::unique_ptr<labels> l(new run_labels(fn));
+      if(static_cast<run_labels*>(l.get())->r.dims() != dims) {
+        throw std::invalid_argument("the index is not for '" + fn + "'");
+      }
+      return l;
+    }
+    const nrrd n(fn.c_str());
+    if(n.dimensions() != dims) {
+      throw std::invalid_argument("the index is not for '" + fn + "'");
+    }
+    switch(n.datatype()) {
+      case nrrd::UINT8: return std::unique_ptr<labels>(
+                          new raw_labels<uint8_t>(n, dims));
+      case nrrd::UINT16: return std::unique_ptr<labels>(
+                           new raw_labels<uint16_t>(n, dims));
+      case nrrd::UINT32: return std::unique_ptr<labels>(
+                           new raw_labels<uint32_t>(n, dims));
+      case nrrd::UINT64: return std::unique_ptr<labels>(
+                           new raw_labels<uint64_t>(n, dims));
+      default: throw std::domain_error("labels must be unsigned integers");
+    }
+  }
+
+  // fills the box 'e' of 'out': with the labels of the whole box if
+  // 'region', else 1 on the voxels of 'label' only, which needs nothing but
+  // the scanlines the index lists.
+  template<typename O>
+  void crop(const labels& in, const index_file& idx, uint64_t label,
+            bool region, O* out) {
+    const component_entry& e = idx.entry(label);
+    const uint64_t ny = idx.dims()[1];
+    const uint64_t cx = e.hi[0]-e.lo[0], cy = e.hi[1]-e.lo[1];
+    std::vector<uint64_t> row(cx);
+    auto copy = [&](uint64_t s) {
+      const uint64_t y = s % ny, z = s / ny;
+      in.read(s, e.lo[0], e.hi[0], row.data());
+      O* dst = out + ((z-e.lo[2])*cy + (y-e.lo[1]))*cx;
+      for(uint64_t x=0; x < cx; ++x) {
+        dst[x] = region ? static_cast<O>(row[x]) : O(row[x] == label);
+      }
+    };
+    if(region) {
+      for(uint64_t z=e.lo[2]; z < e.hi[2]; ++z) {
+        for(uint64_t y=e.lo[1]; y < e.hi[1]; ++y) { copy(z*ny + y); }
+      }
+    } else {
+      const uint64_t* s = idx.scanlines(label);
+      for(uint64_t i=0; i < e.count; ++i) { copy(s[i]); }
+    }
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  if(argc < 6 || argc > 7) {
+    std::cerr << "Usage: " << argv[0]
+              << " labels index label out-raw out-nhdr [mask|region]\n"
+              << "  crops one component out of a label volume (an nhdr or a "
+              << "runs file),\n  using the index ccom wrote with 'outindex'.\n"
+              << "  mask: 1 on the component, 0 elsewhere (default)\n"
+              << "  region: all labels within the component's bounding box\n";
+    return EXIT_FAILURE;
+  }
+  const bool region = argc > 6 && strcmp(argv[6], "region") == 0;
+  if(argc > 6 && !region && strcmp(argv[6], "mask") != 0) {
+    std::cerr << "output must be 'mask' or 'region'\n";
+    return EXIT_FAILURE;
+  }
+
+  try {
+    const index_file idx(argv[2]);
+    const uint64_t label = std::strtoull(argv[3], NULL, 10);
+    const component_entry& e = idx.entry(label);
+    const std::unique_ptr<labels> in = open_labels(argv[1], idx.dims());
+
+    const std::array<uint64_t,3> dims = {{
+      e.hi[0]-e.lo[0], e.hi[1]-e.lo[1], e.hi[2]-e.lo[2]
+    }};
+    const uint64_t voxels = dims[0]*dims[1]*dims[2];
+    const nrrd::dtype type = region ? in->type() : nrrd::UINT8;
+    nrrd::write_header(argv[5], dims, type, argv[4]);
+    std::clog << "component " << label << ": " << e.voxels << " voxels in "
+              << dims[0] << "x" << dims[1] << "x" << dims[2] << " at "
+              << e.lo[0] << "," << e.lo[1] << "," << e.lo[2] << "\n";
+    // start from an empty file; mapping a stale, longer one would keep its
+    // tail.  the mapping then reads back as zeros.
+    std::ofstream(argv[4], std::ios::binary | std::ios::trunc).close();
+    if(voxels == 0) { return EXIT_SUCCESS; }
+
+    memory out(argv[4], voxels * nrrd::bytes(type));
+    if(!out) {
+      std::cerr << "Could not create '" << argv[4] << "'\n";
+      return EXIT_FAILURE;
+    }
+    switch(type) {
+      case nrrd::UINT8:
+        crop(*in, idx, label, region, static_cast<uint8_t*>(out.map)); break;
+      case nrrd::UINT16:
+        crop(*in, idx, label, region, static_cast<uint16_t*>(out.map)); break;
+      case nrrd::UINT32:
+        crop(*in, idx, label, region, static_cast<uint32_t*>(out.map)); break;
+      default:
+        crop(*in, idx, label, region, static_cast<uint64_t*>(out.map)); break;
+    }
+  } catch(const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -1,4 +1,5 @@
 #include <fstream>
+#include <unistd.h>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
@@ -19,10 +20,59 @@ std::string nrrd::type(enum dtype t) {
     case INT64: return "int64";
     case FLOAT: return "float";
     case DOUBLE: return "double";
+    case BIT: return "bit";
   }
   throw std::domain_error("unknown type");
 }
 
+size_t nrrd::bytes(enum dtype t) {
+  switch(t) {
+    case UINT8: case INT8: return 1;
+    case UINT16: case INT16: return 2;
+    case UINT32: case INT32: case FLOAT: return 4;
+    case UINT64: case INT64: case DOUBLE: return 8;
+    case BIT: throw std::domain_error("bit masks have no element size");
+  }
+  throw std::domain_error("unknown type");
+}
+
+nrrd::dtype nrrd::unsigned_type(uint64_t max) {
+  if(max <= UINT8_MAX) { return UINT8; }
+  if(max <= UINT16_MAX) { return UINT16; }
+  if(max <= UINT32_MAX) { return UINT32; }
+  return UINT64;
+}
+
+void nrrd::write_header(std::string nhdr, const std::array<uint64_t,3>& dims,
+                        dtype t, std::string rawfn) {
+  write_header(nhdr, dims, t, rawfn, whole_roi(dims));
+}
+
+void nrrd::write_header(std::string nhdr, const std::array<uint64_t,3>& dims,
+                        dtype t, std::string rawfn, const roi& region) {
+  const std::array<uint64_t,3>& o = region.offset;
+  const std::array<uint64_t,3>& s = region.stride;
+  const bool placed = o[0] != 0 || o[1] != 0 || o[2] != 0 ||
+                      s[0] != 1 || s[1] != 1 || s[2] != 1;
+  std::ofstream hdr(nhdr.c_str(), std::ios::out);
+  // the space fields came with version 4 of the format.
+  hdr << (placed ? "NRRD0004\n" : "NRRD0002\n")
+      << "dimension: 3\n"
+      << "sizes: " << dims[0] << " " << dims[1] << " " << dims[2] << "\n"
+      << "type: " << nrrd::type(t) << "\n"
+      << "encoding: raw\n"
+      << "data file: " << rawfn << "\n";
+  if(placed) {
+    hdr << "space dimension: 3\n"
+        << "space origin: (" << o[0] << "," << o[1] << "," << o[2] << ")\n"
+        << "space directions: (" << s[0] << ",0,0) (0," << s[1] << ",0) "
+        << "(0,0," << s[2] << ")\n";
+  }
+  if(!hdr) {
+    throw std::runtime_error("could not write header '" + nhdr + "'");
+  }
+}
+
 struct nrrd_impl {
   nrrd_impl(const char* fn);
   std::array<uint64_t, 3> dimensions();
@@ -83,6 +133,8 @@ nrrd::dtype nrrd_impl::datatype() {
     return nrrd::dtype::FLOAT;
   } else if(typ == "double") {
     return nrrd::dtype::DOUBLE;
+  } else if(typ == "bit") {
+    return nrrd::dtype::BIT;
   }
 
   std::clog << "unknown nrrd type '" << typ << "'!\n";
@@ -125,3 +177,11 @@ size_t nrrd::n_dimensions() { return m->n_dimensions(); }
 nrrd::dtype nrrd::datatype() const { return m->datatype(); }
 
 std::string nrrd::filename() const { return m->filename(); }
+
+std::string nrrd::datafile() const {
+  const std::string f = m->filename();
+  if(access(f.c_str(), F_OK) == 0 || (!f.empty() && f[0] == '/')) {
+    return f;
+  }
+  return dirname_fixed(m->fn) + "/" + f;
+}
@@ -2,17 +2,35 @@
 #define TJF_FILTER_NRRD_H
 
 #include <array>
+#include <cstdint>
 #include <memory>
 #include <string>
+#include "volume.h"
 
 struct nrrd_impl;
 
 class nrrd {
   public:
+    /// BIT is our own: a bit-packed mask, see bitmask.h.
     enum dtype {
-      UINT8, INT8, UINT16, INT16, UINT32, INT32, UINT64, INT64, FLOAT, DOUBLE
+      UINT8, INT8, UINT16, INT16, UINT32, INT32, UINT64, INT64, FLOAT, DOUBLE,
+      BIT
     };
     static std::string type(enum dtype);
+    /// size of one element; throws std::domain_error for BIT.
+    static size_t bytes(enum dtype);
+    /// the narrowest unsigned type which holds 'max'.
+    static dtype unsigned_type(uint64_t max);
+    /// writes a (detached) header describing the raw file 'rawfn'.
+    static void write_header(std::string nhdr,
+                             const std::array<uint64_t,3>& dims, dtype,
+                             std::string rawfn);
+    /// the same, for 'region' of a larger volume.  unless that starts at
+    /// the origin with unit strides, the header's 'space origin' and 'space
+    /// directions' say where it lies, in the larger volume's voxels.
+    static void write_header(std::string nhdr,
+                             const std::array<uint64_t,3>& dims, dtype,
+                             std::string rawfn, const roi& region);
 
   public:
     nrrd(const char* fn);
@@ -27,6 +45,9 @@ class nrrd {
     // we don't provide data access from this class.  instead, we assume all
     // nrrds are 'detached' and just give the user the filename.
     virtual std::string filename() const;
+    // the data file, as we can open it: 'filename' is taken relative to the
+    // current directory first, then relative to the header's directory.
+    virtual std::string datafile() const;
 
   private:
     std::unique_ptr<nrrd_impl> m;
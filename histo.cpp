@@ -0,0 +1,31 @@
+#include <cstdlib>
+#include <iostream>
+
+#include "f-nrrd.h"
+#include "histogram.h"
+
+int main(int argc, char* argv[])
+{
+  if(argc < 2 || argc > 4) {
+    std::cerr << "Usage: " << argv[0] << " in-nhdr [stride [bins]]\n"
+              << "  stride: only look at every Nth value (default 1)\n"
+              << "  bins: bins for 32/64bit and floating point data\n";
+    return EXIT_FAILURE;
+  }
+  const uint64_t stride = argc > 2 ? std::strtoull(argv[2], NULL, 10) : 1;
+  const size_t nbins = argc > 3 ? std::strtoull(argv[3], NULL, 10) : 4096;
+
+  nrrd n(argv[1]);
+  const histogram h = make_histogram(n.datafile(), n.datatype(), stride,
+                                     nbins);
+
+  std::cout << "# samples: " << h.total() << "\n"
+            << "# otsu: " << otsu(h) << "\n";
+  for(double p : {1.0, 5.0, 50.0, 95.0, 99.0}) {
+    std::cout << "# p" << p << ": " << percentile(h, p) << "\n";
+  }
+  for(size_t b=0; b < h.bins.size(); ++b) {
+    if(h.bins[b] != 0) { std::cout << h.value(b) << " " << h.bins[b] << "\n"; }
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,260 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <limits>
+#include <numeric>
+#include <omp.h>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+#include "histogram.h"
+#include "mmap-memory.h"
+
+uint64_t histogram::total() const {
+  return std::accumulate(bins.begin(), bins.end(), uint64_t(0));
+}
+
+namespace {
+  // 8 and 16 bit data gets a bin for every possible value.
+  template<typename T> struct exact : std::integral_constant<bool,
+    std::is_integral<T>::value && sizeof(T) <= 2> { };
+
+  // widens [mn, mx] to the (non-NaN) values among every 'stride'th of 'n'.
+  template<typename T> void range(const T* data, uint64_t n, uint64_t stride,
+                                  double& mn, double& mx) {
+    const int64_t samples = (n + stride - 1) / stride;
+    double lo = mn, hi = mx;
+    #pragma omp parallel for reduction(min:lo) reduction(max:hi)
+    for(int64_t i=0; i < samples; ++i) {
+      const double v = data[i*stride];
+      if(v != v) { continue; } // NaN
+      lo = std::min(lo, v);
+      hi = std::max(hi, v);
+    }
+    mn = lo;
+    mx = hi;
+  }
+
+  template<typename T> void setup(histogram& h, double, double, size_t,
+                                  std::true_type) {
+    h.lo = std::numeric_limits<T>::min();
+    h.width = 1.0;
+    h.bins.assign(size_t(1) << (8*sizeof(T)), 0);
+  }
+  // 'nbins' bins over [mn, mx].
+  template<typename T> void setup(histogram& h, double mn, double mx,
+                                  size_t nbins, std::false_type) {
+    if(mx < mn) { mn = mx = 0.0; } // no (non-NaN) data.
+    h.lo = mn;
+    h.width = mx > mn ? (mx - mn) / nbins : 1.0;
+    h.bins.assign(nbins, 0);
+  }
+
+  template<typename T> size_t bin(const histogram& h, T v, std::true_type) {
+    return static_cast<int64_t>(v) - static_cast<int64_t>(h.lo);
+  }
+  template<typename T> size_t bin(const histogram& h, T v, std::false_type) {
+    const double b = (static_cast<double>(v) - h.lo) / h.width;
+    return std::min(static_cast<size_t>(b), h.bins.size()-1);
+  }
+
+  // counts every 'stride'th of 'n' values into 'h', which spans them.
+  template<typename T> void fill(histogram& h, const T* data, uint64_t n,
+                                 uint64_t stride) {
+    // every thread fills its own bins; they are summed at the end, so there
+    // is no contention on popular bins.
+    const int64_t samples = (n + stride - 1) / stride;
+    #pragma omp parallel
+    {
+      std::vector<uint64_t> mine(h.bins.size(), 0);
+      #pragma omp for schedule(static)
+      for(int64_t i=0; i < samples; ++i) {
+        const T v = data[i*stride];
+        if(v != v) { continue; } // NaN
+        ++mine[bin(h, v, exact<T>())];
+      }
+      #pragma omp critical
+      {
+        for(size_t b=0; b < mine.size(); ++b) { h.bins[b] += mine[b]; }
+      }
+    }
+  }
+
+  const double none_lo = std::numeric_limits<double>::max();
+  const double none_hi = -std::numeric_limits<double>::max();
+
+  template<typename T> histogram pieces_histogram(
+    const std::function<void(const piece_fn&)>& each, uint64_t stride,
+    size_t nbins)
+  {
+    double mn = none_lo, mx = none_hi;
+    if(!exact<T>::value) { // binning needs the range first.
+      each([&](const void* data, uint64_t n) {
+        range(static_cast<const T*>(data), n, stride, mn, mx);
+      });
+    }
+    histogram h;
+    setup<T>(h, mn, mx, nbins, exact<T>());
+    each([&](const void* data, uint64_t n) {
+      fill(h, static_cast<const T*>(data), n, stride);
+    });
+    return h;
+  }
+}
+
+template<typename T> histogram make_histogram(const T* data, uint64_t n,
+                                              uint64_t stride, size_t nbins)
+{
+  if(stride == 0 || nbins == 0) {
+    throw std::invalid_argument("stride and bin count must be positive");
+  }
+  double mn = none_lo, mx = none_hi;
+  if(!exact<T>::value) { range(data, n, stride, mn, mx); }
+  histogram h;
+  setup<T>(h, mn, mx, nbins, exact<T>());
+  fill(h, data, n, stride);
+  return h;
+}
+
+template histogram make_histogram(const uint8_t*, uint64_t, uint64_t, size_t);
+template histogram make_histogram(const uint16_t*, uint64_t, uint64_t, size_t);
+template histogram make_histogram(const uint32_t*, uint64_t, uint64_t, size_t);
+template histogram make_histogram(const uint64_t*, uint64_t, uint64_t, size_t);
+template histogram make_histogram(const int8_t*, uint64_t, uint64_t, size_t);
+template histogram make_histogram(const int16_t*, uint64_t, uint64_t, size_t);
+template histogram make_histogram(const int32_t*, uint64_t, uint64_t, size_t);
+template histogram make_histogram(const int64_t*, uint64_t, uint64_t, size_t);
+template histogram make_histogram(const float*, uint64_t, uint64_t, size_t);
+template histogram make_histogram(const double*, uint64_t, uint64_t, size_t);
+
+histogram make_histogram(const void* data, uint64_t n, nrrd::dtype t,
+                         uint64_t stride, size_t nbins)
+{
+#define TJF_HISTOGRAM(T) \
+  return make_histogram(static_cast<const T*>(data), n, stride, nbins)
+  switch(t) {
+    case nrrd:: UINT8: TJF_HISTOGRAM( uint8_t);
+    case nrrd::UINT16: TJF_HISTOGRAM(uint16_t);
+    case nrrd::UINT32: TJF_HISTOGRAM(uint32_t);
+    case nrrd::UINT64: TJF_HISTOGRAM(uint64_t);
+    case nrrd:: INT8: TJF_HISTOGRAM( int8_t);
+    case nrrd::INT16: TJF_HISTOGRAM(int16_t);
+    case nrrd::INT32: TJF_HISTOGRAM(int32_t);
+    case nrrd::INT64: TJF_HISTOGRAM(int64_t);
+    case nrrd::FLOAT: TJF_HISTOGRAM(float);
+    case nrrd::DOUBLE: TJF_HISTOGRAM(double);
+    case nrrd::BIT: throw std::domain_error("bit masks have no histogram");
+  }
+#undef TJF_HISTOGRAM
+  throw std::domain_error("unknown type");
+}
+
+histogram make_histogram(const std::function<void(const piece_fn&)>& each,
+                         nrrd::dtype t, uint64_t stride, size_t nbins)
+{
+  if(stride == 0 || nbins == 0) {
+    throw std::invalid_argument("stride and bin count must be positive");
+  }
+#define TJF_HISTOGRAM(T) return pieces_histogram<T>(each, stride, nbins)
+  switch(t) {
+    case nrrd:: UINT8: TJF_HISTOGRAM( uint8_t);
+    case nrrd::UINT16: TJF_HISTOGRAM(uint16_t);
+    case nrrd::UINT32: TJF_HISTOGRAM(uint32_t);
+    case nrrd::UINT64: TJF_HISTOGRAM(uint64_t);
+    case nrrd:: INT8: TJF_HISTOGRAM( int8_t);
+    case nrrd::INT16: TJF_HISTOGRAM(int16_t);
+    case nrrd::INT32: TJF_HISTOGRAM(int32_t);
+    case nrrd::INT64: TJF_HISTOGRAM(int64_t);
+    case nrrd::FLOAT: TJF_HISTOGRAM(float);
+    case nrrd::DOUBLE: TJF_HISTOGRAM(double);
+    case nrrd::BIT: throw std::domain_error("bit masks have no histogram");
+  }
+#undef TJF_HISTOGRAM
+  throw std::domain_error("unknown type");
+}
+
+histogram make_histogram(std::string rawfn, nrrd::dtype t, uint64_t stride,
+                         size_t nbins)
+{
+  memory in(rawfn.c_str());
+  if(!in) { // empty, or unreadable.
+    return make_histogram(NULL, 0, t, stride, nbins);
+  }
+  return make_histogram(in.map, in.length / nrrd::bytes(t), t, stride, nbins);
+}
+
+double otsu(const histogram& h)
+{
+  // maximize the between-class variance; we work in bin units.
+  const double n = h.total();
+  double sum = 0.0;
+  for(size_t b=0; b < h.bins.size(); ++b) { sum += double(b) * h.bins[b]; }
+
+  double wlow = 0.0, sumlow = 0.0, best = -1.0;
+  size_t threshold = 0;
+  for(size_t b=0; b+1 < h.bins.size(); ++b) {
+    wlow += h.bins[b];
+    sumlow += double(b) * h.bins[b];
+    const double whigh = n - wlow;
+    if(wlow == 0.0) { continue; }
+    if(whigh == 0.0) { break; }
+    const double mdiff = sumlow / wlow - (sum - sumlow) / whigh;
+    const double between = wlow * whigh * mdiff * mdiff;
+    if(between > best) {
+      best = between;
+      threshold = b+1;
+    }
+  }
+  return h.value(threshold);
+}
+
+double percentile(const histogram& h, double p)
+{
+  if(p < 0.0 || p > 100.0) {
+    throw std::out_of_range("percentile must be in [0,100]");
+  }
+  const double target = std::ceil(h.total() * p / 100.0);
+  uint64_t cumulative = 0;
+  for(size_t b=0; b < h.bins.size(); ++b) {
+    cumulative += h.bins[b];
+    if(cumulative >= target && cumulative > 0) { return h.value(b); }
+  }
+  return h.value(h.bins.empty() ? 0 : h.bins.size()-1);
+}
+
+auto_bounds::auto_bounds(std::string fn, nrrd::dtype t) :
+  make([fn, t](uint64_t stride) { return make_histogram(fn, t, stride); })
+{ }
+
+auto_bounds::auto_bounds(std::function<histogram(uint64_t)> m) : make(m) { }
+
+std::string auto_bounds::operator()(std::string bound)
+{
+  const std::string prefix("auto:");
+  if(bound.compare(0, prefix.size(), prefix) != 0) { return bound; }
+
+  std::string method = bound.substr(prefix.size());
+  uint64_t stride = 1;
+  const size_t slash = method.find('/');
+  if(slash != std::string::npos) {
+    stride = std::strtoull(method.c_str()+slash+1, NULL, 10);
+    method = method.substr(0, slash);
+  }
+  if(this->cache.count(stride) == 0) {
+    this->cache[stride] = this->make(stride);
+  }
+  const histogram& h = this->cache[stride];
+
+  double v;
+  if(method == "otsu") {
+    v = otsu(h);
+  } else if(method.size() > 1 && method[0] == 'p') {
+    v = percentile(h, std::strtod(method.c_str()+1, NULL));
+  } else {
+    throw std::invalid_argument("unknown automatic bound '" + bound + "'");
+  }
+  std::ostringstream os;
+  os << std::setprecision(17) << v;
+  return os.str();
+}
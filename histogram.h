@@ -0,0 +1,71 @@
+/* Histograms of volume data, computed in parallel with per-thread bins, and
+ * the automatic thresholds we derive from them. */
+#ifndef TJF_HISTOGRAM_H
+#define TJF_HISTOGRAM_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include "f-nrrd.h"
+
+struct histogram {
+  double lo;    ///< lower edge of the first bin
+  double width; ///< width of every bin
+  std::vector<uint64_t> bins;
+
+  /// lower edge of bin 'b'.  for exact histograms, the value itself.
+  double value(size_t b) const { return lo + b*width; }
+  uint64_t total() const;
+};
+
+/// exact (one bin per value) for 8 and 16 bit data; otherwise 'nbins' bins
+/// spanning the range of the data.  only every 'stride'th value is looked
+/// at, which gives quick estimates for huge volumes.
+template<typename T> histogram make_histogram(const T* data, uint64_t n,
+                                              uint64_t stride=1,
+                                              size_t nbins=4096);
+/// as above, for 'n' values of type 't'.
+histogram make_histogram(const void* data, uint64_t n, nrrd::dtype t,
+                         uint64_t stride=1, size_t nbins=4096);
+/// 'n' values, of which every 'stride'th is looked at, from the first on.
+typedef std::function<void(const void* data, uint64_t n)> piece_fn;
+/// as above, for data which is never in memory all at once: 'each(f)'
+/// calls 'f' on every piece of it, in turn.  pieces are given from their
+/// first sample on, so that the samples are every 'stride'th value of the
+/// whole.  for 'nbins' bins (wide types), the data is gone through twice:
+/// once for its range, once for the counts.
+histogram make_histogram(const std::function<void(const piece_fn&)>& each,
+                         nrrd::dtype t, uint64_t stride=1,
+                         size_t nbins=4096);
+/// as above, for the raw file 'rawfn' holding values of type 't'.
+histogram make_histogram(std::string rawfn, nrrd::dtype t, uint64_t stride=1,
+                         size_t nbins=4096);
+
+/// Otsu's threshold: the lowest value of the upper class.
+double otsu(const histogram&);
+/// the smallest value v such that at least p percent of the data is <= v.
+/// for binned histograms this is only good to a bin's width.
+double percentile(const histogram&, double p);
+
+/// resolves automatic bounds for threshold and ccom.  a bound is either a
+/// number, which we give back untouched, or one of:
+///   auto:otsu    Otsu's threshold
+///   auto:pNN     the NN'th percentile, e.g. auto:p99.5
+/// optionally followed by "/N" to subsample every Nth value, e.g.
+/// auto:otsu/64.  the histogram is computed on first use.
+class auto_bounds {
+  public:
+    /// for the raw file 'rawfn'.
+    auto_bounds(std::string rawfn, nrrd::dtype);
+    /// for data anywhere else: 'make(stride)' gives its histogram.
+    explicit auto_bounds(std::function<histogram(uint64_t)> make);
+    std::string operator()(std::string bound);
+
+  private:
+    std::function<histogram(uint64_t)> make;
+    std::map<uint64_t, histogram> cache; ///< by stride
+};
+
+#endif /* TJF_HISTOGRAM_H */
@@ -8,7 +8,9 @@
 #include <unistd.h>
 #include "mmap-memory.h"
 
-memory::memory(const char* fn, size_t sz) : fd(-1), map(MAP_FAILED) {
+memory::memory(const char* fn, size_t sz, size_t offset) :
+  fd(-1), map(MAP_FAILED), base(MAP_FAILED)
+{
   const int access = O_RDWR | O_CREAT;
   this->fd = ::open(fn, access, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
 
@@ -16,7 +18,7 @@ memory::memory(const char* fn, size_t sz) : fd(-1), map(MAP_FAILED) {
 #if _POSIX_C_SOURCE >= 200112L
   {
     int err;
-    if((err = posix_fallocate(this->fd, 0, sz)) != 0) {
+    if((err = posix_fallocate(this->fd, offset, sz)) != 0) {
       std::cerr << "fallocate failed, err=" << err << "\n";
       this->close();
       return;
@@ -24,13 +26,17 @@ memory::memory(const char* fn, size_t sz) : fd(-1), map(MAP_FAILED) {
   }
 #endif
 
-  const int mm_protection = PROT_WRITE;
+  const int mm_protection = PROT_READ | PROT_WRITE;
   const int mm_flags = MAP_SHARED;
 
-  /* length must be a multiple of the page size.  Round it up. */
+  /* the file offset must be a multiple of the page size.  Round it down and
+   * remember how far we are off. */
   const long page_size = sysconf(_SC_PAGESIZE);
   const uint64_t u_page_size = static_cast<uint64_t>(page_size);
-  this->length = sz;
+  const size_t slop = page_size != -1 ? offset % u_page_size : 0;
+
+  /* length must be a multiple of the page size.  Round it up. */
+  this->length = sz + slop;
   if(page_size != -1 && (this->length % u_page_size) != 0) {
     /* i.e. sysconf was successful and length isn't a multiple of page size. */
     this->length += (u_page_size * ((this->length-1) / u_page_size)) +
@@ -39,22 +45,45 @@ memory::memory(const char* fn, size_t sz) : fd(-1), map(MAP_FAILED) {
   }
   assert(this->length > 0);
 
-  this->map = ::mmap(NULL, this->length, mm_protection, mm_flags, this->fd, 0);
-  if(MAP_FAILED == this->map) {
+  this->base = ::mmap(NULL, this->length, mm_protection, mm_flags, this->fd,
+                      offset - slop);
+  if(MAP_FAILED == this->base) {
+    this->close();
+    return;
+  }
+  this->map = static_cast<char*>(this->base) + slop;
+}
+
+memory::memory(const char* fn) : fd(-1), map(MAP_FAILED), base(MAP_FAILED),
+  length(0)
+{
+  this->fd = ::open(fn, O_RDONLY);
+  if(this->fd == -1) { return; }
+
+  struct stat st;
+  if(fstat(this->fd, &st) != 0 || st.st_size == 0) {
+    this->close();
+    return;
+  }
+  this->length = st.st_size;
+  this->base = ::mmap(NULL, this->length, PROT_READ, MAP_SHARED, this->fd, 0);
+  if(MAP_FAILED == this->base) {
     this->close();
+    return;
   }
+  this->map = this->base;
 }
 
 memory::~memory() { this->close(); }
 
 void memory::close() {
-  if(this->map != MAP_FAILED) {
-    int mu = munmap(this->map, this->length);
+  if(this->base != MAP_FAILED) {
+    int mu = munmap(this->base, this->length);
     if(mu != 0) {
       throw std::invalid_argument("could not munmap file");
     }
   }
-  this->map = MAP_FAILED;
+  this->map = this->base = MAP_FAILED;
 
   if(this->fd != -1) {
     int cl;
@@ -1,11 +1,17 @@
 #ifndef TJF_MMAP_MEMORY_H
 #define TJF_MMAP_MEMORY_H
 
+#include <cstddef>
 #include <sys/mman.h>
 
 /// mmap-backed memory
 struct memory {
-  memory(const char* fn, size_t sz);
+  /// maps 'sz' bytes of 'fn', starting at byte 'offset'.  the file is created
+  /// and/or extended as needed.  the offset need not be page aligned.
+  memory(const char* fn, size_t sz, size_t offset=0);
+  /// maps all of the existing file 'fn', read only.  empty files cannot be
+  /// mapped, so they give an invalid object.
+  explicit memory(const char* fn);
   ~memory();
 
   explicit operator bool() const {
@@ -15,7 +21,8 @@ struct memory {
   void close();
 
   int fd;
-  void* map;
+  void* map; ///< the requested region; 'base' plus the alignment slop
+  void* base; ///< what mmap actually gave us
   size_t length;
 };
 
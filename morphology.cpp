@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <limits>
+#include <omp.h>
+#include <stdexcept>
+#include <vector>
+#include "morphology.h"
+
+morph_op morph_operation(std::string op)
+{
+  if(op == "erode") { return ERODE; }
+  if(op == "dilate") { return DILATE; }
+  if(op == "open") { return OPEN; }
+  if(op == "close") { return CLOSE; }
+  throw std::invalid_argument("operation must be erode, dilate, open or "
+                              "close");
+}
+
+morph_shape morph_element(std::string shape)
+{
+  if(shape == "box") { return BOX; }
+  if(shape == "cross") { return CROSS; }
+  throw std::invalid_argument("structuring element must be box or cross");
+}
+
+namespace {
+  template<typename T> struct minimum {
+    T operator()(T a, T b) const { return b < a ? b : a; }
+    static T identity() { return std::numeric_limits<T>::max(); }
+  };
+  template<typename T> struct maximum {
+    T operator()(T a, T b) const { return a < b ? b : a; }
+    static T identity() { return std::numeric_limits<T>::lowest(); }
+  };
+
+  // van Herk/Gil-Werman running min/max of width 2r+1 over 'n' values.  the
+  // line is padded with r identities on each side and cut into blocks of the
+  // window width; any window then spans at most two blocks and is the
+  // combination of a suffix of the first and a prefix of the second.
+  // 'g' and 'h' are scratch space.
+  template<typename T, typename Op>
+  void vhgw(const T* in, T* out, size_t n, size_t r, Op op,
+            std::vector<T>& g, std::vector<T>& h) {
+    const size_t w = 2*r + 1;
+    const size_t m = n + 2*r;
+    g.resize(m);
+    h.resize(m);
+    auto padded = [&](size_t i) {
+      return (r <= i && i < r+n) ? in[i-r] : Op::identity();
+    };
+    for(size_t i=0; i < m; ++i) { // prefixes
+      g[i] = (i % w == 0) ? padded(i) : op(g[i-1], padded(i));
+    }
+    for(size_t i=m; i-- > 0; ) { // suffixes
+      h[i] = (i % w == w-1 || i == m-1) ? padded(i) : op(h[i+1], padded(i));
+    }
+    for(size_t i=0; i < n; ++i) { out[i] = op(h[i], g[i+w-1]); }
+  }
+
+  // filters every line along 'axis' of 'src' and writes it to 'dst', or
+  // combines it with what is in 'dst' if 'combine' is set.  src may be dst.
+  template<typename T, typename Op>
+  void pass(const T* src, T* dst, const std::array<uint64_t,3>& dims,
+            size_t axis, size_t r, Op op, bool combine) {
+    const std::array<uint64_t,3> stride = {{1, dims[0], dims[0]*dims[1]}};
+    const size_t a = (axis+1) % 3, b = (axis+2) % 3;
+    const uint64_t n = dims[axis];
+    const int64_t lines = dims[a]*dims[b];
+    #pragma omp parallel
+    {
+      std::vector<T> line(n), filtered(n), g, h;
+      #pragma omp for schedule(static)
+      for(int64_t l=0; l < lines; ++l) {
+        const uint64_t start = (l % dims[a])*stride[a] +
+                               (l / dims[a])*stride[b];
+        for(uint64_t i=0; i < n; ++i) {
+          line[i] = src[start + i*stride[axis]];
+        }
+        vhgw(line.data(), filtered.data(), n, r, op, g, h);
+        for(uint64_t i=0; i < n; ++i) {
+          T& d = dst[start + i*stride[axis]];
+          d = combine ? op(d, filtered[i]) : filtered[i];
+        }
+      }
+    }
+  }
+
+  template<typename T, typename Op>
+  void filter(T* data, const std::array<uint64_t,3>& dims, morph_shape shape,
+              size_t r, Op op) {
+    if(shape == BOX) { // separable: x, then y, then z.
+      for(size_t axis=0; axis < 3; ++axis) {
+        pass(data, data, dims, axis, r, op, false);
+      }
+      return;
+    }
+    // the cross is the union of three lines, so the result is the
+    // combination of three 1D filters of the *original* data.
+    const std::vector<T> orig(data, data + dims[0]*dims[1]*dims[2]);
+    pass(orig.data(), data, dims, 0, r, op, false);
+    pass(orig.data(), data, dims, 1, r, op, true);
+    pass(orig.data(), data, dims, 2, r, op, true);
+  }
+}
+
+template<typename T> void morphology(T* data,
+                                     const std::array<uint64_t,3>& dims,
+                                     morph_op op, morph_shape shape,
+                                     size_t width)
+{
+  if(width % 2 == 0) {
+    throw std::invalid_argument("structuring element width must be odd");
+  }
+  if(dims[0]*dims[1]*dims[2] == 0) { return; }
+  const size_t r = width / 2;
+  switch(op) {
+    case ERODE: filter(data, dims, shape, r, minimum<T>()); break;
+    case DILATE: filter(data, dims, shape, r, maximum<T>()); break;
+    case OPEN:
+      filter(data, dims, shape, r, minimum<T>());
+      filter(data, dims, shape, r, maximum<T>());
+      break;
+    case CLOSE:
+      filter(data, dims, shape, r, maximum<T>());
+      filter(data, dims, shape, r, minimum<T>());
+      break;
+  }
+}
+
+template void morphology(uint8_t*, const std::array<uint64_t,3>&, morph_op,
+                         morph_shape, size_t);
+template void morphology(uint16_t*, const std::array<uint64_t,3>&, morph_op,
+                         morph_shape, size_t);
+template void morphology(uint32_t*, const std::array<uint64_t,3>&, morph_op,
+                         morph_shape, size_t);
+template void morphology(uint64_t*, const std::array<uint64_t,3>&, morph_op,
+                         morph_shape, size_t);
+template void morphology(int8_t*, const std::array<uint64_t,3>&, morph_op,
+                         morph_shape, size_t);
+template void morphology(int16_t*, const std::array<uint64_t,3>&, morph_op,
+                         morph_shape, size_t);
+template void morphology(int32_t*, const std::array<uint64_t,3>&, morph_op,
+                         morph_shape, size_t);
+template void morphology(int64_t*, const std::array<uint64_t,3>&, morph_op,
+                         morph_shape, size_t);
+template void morphology(float*, const std::array<uint64_t,3>&, morph_op,
+                         morph_shape, size_t);
+template void morphology(double*, const std::array<uint64_t,3>&, morph_op,
+                         morph_shape, size_t);
@@ -0,0 +1,27 @@
+/* Grayscale morphology via the van Herk/Gil-Werman algorithm: the cost per
+ * voxel is constant, no matter how wide the structuring element is. */
+#ifndef TJF_MORPHOLOGY_H
+#define TJF_MORPHOLOGY_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+enum morph_op { ERODE, DILATE, OPEN, CLOSE };
+enum morph_shape {
+  BOX,  ///< width^3 cube
+  CROSS ///< three axis-aligned lines of length 'width' through the center
+};
+
+morph_op morph_operation(std::string);
+morph_shape morph_element(std::string);
+
+/// applies 'op' in place to 'data', an x-fastest volume of size 'dims'.
+/// 'width' is the (odd) extent of the structuring element along each axis.
+/// outside the volume is ignored, i.e. windows are clipped at the border.
+template<typename T> void morphology(T* data,
+                                     const std::array<uint64_t,3>& dims,
+                                     morph_op, morph_shape, size_t width);
+
+#endif /* TJF_MORPHOLOGY_H */
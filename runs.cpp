@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include "runs.h"
+
+static const char magic[8] = { 't','j','f','r','u','n','s','\n' };
+
+run_volume::run_volume() : components(0), index(1, 0) {
+  this->dims.fill(0);
+}
+
+run_volume::run_volume(const std::array<uint64_t,3>& d) : dims(d),
+  components(0), index(1, 0)
+{
+  if(d[0] > std::numeric_limits<uint32_t>::max()) {
+    throw std::length_error("scanlines too long to run-length encode");
+  }
+  this->index.reserve(d[1]*d[2] + 1);
+}
+
+void run_volume::append(const uint64_t* scanline) {
+  const uint64_t width = this->dims[0];
+  for(uint64_t x=0; x < width; ) {
+    if(scanline[x] == 0) { ++x; continue; }
+    uint64_t end = x+1;
+    while(end < width && scanline[end] == scanline[x]) { ++end; }
+    const run r = { static_cast<uint32_t>(x), static_cast<uint32_t>(end-x),
+                    scanline[x] };
+    this->runs.push_back(r);
+    x = end;
+  }
+  this->index.push_back(this->runs.size());
+}
+
+run_volume concatenate(const std::vector<run_volume>& parts)
+{
+  if(parts.empty()) { return run_volume(); }
+  std::array<uint64_t,3> dims = parts[0].dims;
+  dims[2] = 0;
+  uint64_t nruns = 0;
+  for(const run_volume& p : parts) {
+    if(p.dims[0] != dims[0] || p.dims[1] != dims[1]) {
+      throw std::length_error("volumes differ in x or y");
+    }
+    dims[2] += p.dims[2];
+    nruns += p.runs.size();
+  }
+
+  run_volume v(dims);
+  v.runs.reserve(nruns);
+  for(const run_volume& p : parts) {
+    const uint64_t base = v.runs.size();
+    for(size_t i=1; i < p.index.size(); ++i) {
+      v.index.push_back(base + p.index[i]);
+    }
+    v.runs.insert(v.runs.end(), p.runs.begin(), p.runs.end());
+    v.components = std::max(v.components, p.components);
+  }
+  return v;
+}
+
+namespace {
+  template<typename L>
+  bool expand_scanline(uint64_t width, const run* begin, const run* end,
+                       L* out) {
+    std::fill(out, out+width, L(0));
+    bool fits = true;
+    for(const run* r=begin; r != end; ++r) {
+      fits &= r->label <= std::numeric_limits<L>::max();
+      std::fill(out+r->x, out+r->x+r->n, static_cast<L>(r->label));
+    }
+    return fits;
+  }
+}
+
+template<typename L>
+void expand(const std::array<uint64_t,3>& dims, const uint64_t* index,
+            const run* runs, L* out)
+{
+  const int64_t scanlines = dims[1]*dims[2];
+  bool fits = true;
+  #pragma omp parallel for schedule(static) reduction(&&:fits)
+  for(int64_t s=0; s < scanlines; ++s) {
+    fits = expand_scanline(dims[0], runs+index[s], runs+index[s+1],
+                           out + s*dims[0]) && fits;
+  }
+  if(!fits) {
+    throw std::overflow_error("labels do not fit into the output type");
+  }
+}
+
+uint64_t runs_offset(const std::array<uint64_t,3>& dims)
+{
+  return sizeof(magic) + 4*sizeof(uint64_t) +
+         (dims[1]*dims[2] + 1)*sizeof(uint64_t);
+}
+
+void write_runs(std::string fn, const run_volume& v)
+{
+  std::ofstream ofs(fn.c_str(), std::ios::binary | std::ios::trunc);
+  ofs.write(magic, sizeof(magic));
+  ofs.write(reinterpret_cast<const char*>(v.dims.data()),
+            3*sizeof(uint64_t));
+  ofs.write(reinterpret_cast<const char*>(&v.components), sizeof(uint64_t));
+  ofs.write(reinterpret_cast<const char*>(v.index.data()),
+            v.index.size()*sizeof(uint64_t));
+  ofs.write(reinterpret_cast<const char*>(v.runs.data()),
+            v.runs.size()*sizeof(run));
+  if(!ofs) { throw std::runtime_error("could not write runs " + fn); }
+}
+
+bool is_run_file(std::string fn)
+{
+  std::ifstream ifs(fn.c_str(), std::ios::binary);
+  char m[sizeof(magic)];
+  return ifs.read(m, sizeof(m)) && memcmp(m, magic, sizeof(magic)) == 0;
+}
+
+run_file::run_file(std::string fn) : mem(fn.c_str()) {
+  const char* p = static_cast<const char*>(this->mem.map);
+  const size_t header = sizeof(magic) + 4*sizeof(uint64_t);
+  if(!this->mem || this->mem.length < header ||
+     memcmp(p, magic, sizeof(magic)) != 0) {
+    throw std::runtime_error("'" + fn + "' is not a runs file");
+  }
+  this->dims_ = reinterpret_cast<const std::array<uint64_t,3>*>(
+    p + sizeof(magic)
+  );
+  this->components_ = reinterpret_cast<const uint64_t*>(
+    p + sizeof(magic) + 3*sizeof(uint64_t)
+  );
+  this->index_ = reinterpret_cast<const uint64_t*>(p + header);
+  this->runs_ = reinterpret_cast<const run*>(p + runs_offset(this->dims()));
+
+  const uint64_t scanlines = this->dims()[1]*this->dims()[2];
+  if(this->mem.length < runs_offset(this->dims()) ||
+     this->mem.length < runs_offset(this->dims()) +
+                        this->index_[scanlines]*sizeof(run)) {
+    throw std::runtime_error("'" + fn + "' is truncated");
+  }
+}
+
+template<typename L>
+void run_file::scanline(uint64_t y, uint64_t z, L* out) const {
+  if(y >= this->dims()[1] || z >= this->dims()[2]) {
+    throw std::out_of_range("no such scanline");
+  }
+  const uint64_t s = z*this->dims()[1] + y;
+  if(!expand_scanline(this->dims()[0], this->runs_ + this->index_[s],
+                      this->runs_ + this->index_[s+1], out)) {
+    throw std::overflow_error("labels do not fit into the output type");
+  }
+}
+
+template<typename L> void run_file::expand(L* out) const {
+  ::expand(this->dims(), this->index_, this->runs_, out);
+}
+
+#define RUNS_EXPAND(L) \
+  template void expand(const std::array<uint64_t,3>&, const uint64_t*, \
+                       const run*, L*); \
+  template void run_file::scanline(uint64_t, uint64_t, L*) const; \
+  template void run_file::expand(L*) const
+RUNS_EXPAND(uint8_t);
+RUNS_EXPAND(uint16_t);
+RUNS_EXPAND(uint32_t);
+RUNS_EXPAND(uint64_t);
+#undef RUNS_EXPAND
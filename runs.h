@@ -0,0 +1,88 @@
+/* Run-length encoded label volumes.  Label volumes are mostly background,
+ * so rather than every voxel we keep the runs of nonzero labels along each
+ * scanline, plus an index of where each scanline's runs begin.  The index
+ * gives random access to any scanline without decoding the others.
+ *
+ * On disk, in host byte order:
+ *    "tjfruns\n"
+ *    dims            3 x uint64
+ *    components      uint64, the largest label
+ *    index           dims[1]*dims[2]+1 x uint64
+ *    runs            index[dims[1]*dims[2]] x struct run */
+#ifndef TJF_RUNS_H
+#define TJF_RUNS_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "mmap-memory.h"
+
+struct run {
+  uint32_t x; ///< first voxel of the run
+  uint32_t n; ///< length of the run, in voxels
+  uint64_t label;
+};
+
+/// a run-length encoded volume, in memory.
+struct run_volume {
+  /// an empty volume: no scanlines, no runs.
+  run_volume();
+  /// no runs yet, and room for the scanlines of 'dims'.  throws
+  /// std::length_error if a scanline is too long for struct run.
+  explicit run_volume(const std::array<uint64_t,3>& dims);
+
+  /// appends the runs of the next scanline, given as 'dims[0]' labels.
+  void append(const uint64_t* scanline);
+
+  std::array<uint64_t,3> dims;
+  uint64_t components;
+  /// scanline r = z*dims[1] + y has the runs [index[r], index[r+1]).
+  std::vector<uint64_t> index;
+  std::vector<run> runs;
+};
+
+/// glues volumes together along z.  they must agree in x and y.
+run_volume concatenate(const std::vector<run_volume>&);
+
+/// expands runs into 'out', a packed, x-fastest volume of size 'dims'.
+/// throws std::overflow_error if a label does not fit into an L.
+template<typename L>
+void expand(const std::array<uint64_t,3>& dims, const uint64_t* index,
+            const run* runs, L* out);
+
+/// byte offset of the first run, in a file of the given dimensions.
+uint64_t runs_offset(const std::array<uint64_t,3>& dims);
+
+void write_runs(std::string fn, const run_volume&);
+/// whether 'fn' starts out like a runs file.
+bool is_run_file(std::string fn);
+
+/// read access to a runs file, which is mapped rather than read.
+class run_file {
+  public:
+    /// throws std::runtime_error if 'fn' is not a (complete) runs file.
+    explicit run_file(std::string fn);
+
+    const std::array<uint64_t,3>& dims() const { return *this->dims_; }
+    uint64_t components() const { return *this->components_; }
+    const uint64_t* index() const { return this->index_; }
+    const run* runs() const { return this->runs_; }
+
+    /// expands scanline (y,z) into 'dims()[0]' labels.
+    template<typename L> void scanline(uint64_t y, uint64_t z, L* out) const;
+    /// expands the whole volume.
+    template<typename L> void expand(L* out) const;
+
+  private:
+    run_file(const run_file&) = delete;
+    run_file& operator=(const run_file&) = delete;
+
+    memory mem;
+    const std::array<uint64_t,3>* dims_;
+    const uint64_t* components_;
+    const uint64_t* index_;
+    const run* runs_;
+};
+
+#endif /* TJF_RUNS_H */
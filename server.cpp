@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "ccom.h"
+#include "config.h"
+#include "server.h"
+#include "threshold.h"
+#include "volume-cache.h"
+
+namespace {
+  // the answer to one request.  sets 'quit' if the server should stop.
+  std::string serve(volume_cache& cache, std::string request, bool& quit) {
+    std::istringstream is(request);
+    std::string cmd;
+    is >> cmd;
+    if(cmd == "ccom") {
+      std::string cfg;
+      if(!(is >> cfg)) { throw std::invalid_argument("ccom needs a config"); }
+      config c(cfg);
+      const std::shared_ptr<cached_volume> in = cache.get(c.value("in"));
+      const ccom_stats st = ccom(cfg.c_str(), *in);
+      return "ok " + std::to_string(st.components);
+    }
+    if(cmd == "threshold") {
+      std::string in, outraw, outnhdr, lo, hi, extra;
+      if(!(is >> in >> outraw >> outnhdr >> lo)) {
+        throw std::invalid_argument("threshold needs in, out-raw, out-nhdr "
+                                    "and bounds");
+      }
+      const std::shared_ptr<cached_volume> v = cache.get(in);
+      threshold_mode mode = THRESHOLD_VALUES;
+      std::string spec;
+      if(lo == "bands") {
+        mode = THRESHOLD_BANDS;
+        std::getline(is, spec);
+      } else {
+        if(!(is >> hi)) { throw std::invalid_argument("no upper bound"); }
+        if(is >> extra) {
+          if(extra != "mask") {
+            throw std::invalid_argument("unknown option '" + extra + "'");
+          }
+          mode = THRESHOLD_MASK;
+        }
+        spec = v->bounds()(lo) + " " + v->bounds()(hi);
+      }
+      threshold(v->dims(), v->type(), whole_roi(v->dims()), mode, spec,
+                outraw, outnhdr, [&](const slice_fn& apply) {
+        if(v->data()) { apply(v->data(), 0, v->dims()[2]); }
+      });
+      return "ok";
+    }
+    if(cmd == "stats") {
+      std::ostringstream os;
+      os << "ok " << cache.size() << " " << cache.bytes() << " "
+         << cache.budget();
+      return os.str();
+    }
+    if(cmd == "drop") {
+      cache.clear();
+      return "ok";
+    }
+    if(cmd == "quit") {
+      quit = true;
+      return "ok";
+    }
+    throw std::invalid_argument("unknown request '" + cmd + "'");
+  }
+}
+
+std::string answer(volume_cache& cache, const std::string& request,
+                   bool& quit)
+{
+  try {
+    return serve(cache, request, quit);
+  } catch(const std::exception& e) {
+    std::string reply = std::string("error ") + e.what();
+    std::replace(reply.begin(), reply.end(), '\n', ' ');
+    return reply;
+  }
+}
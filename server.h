@@ -0,0 +1,29 @@
+/* The requests tjfd (a resident server for threshold and ccom) serves.  A
+ * request is one line; so is its reply, "ok ..." or "error <what went
+ * wrong>".  Requests are:
+ *
+ *   ccom <config>                          ok <components>
+ *   threshold <in> <out-raw> <out-nhdr> <lo> <hi> [mask]      ok
+ *   threshold <in> <out-raw> <out-nhdr> bands <lo hi class; ...>   ok
+ *   stats                                  ok <volumes> <bytes> <budget>
+ *   drop                                   ok   (forgets all volumes)
+ *   quit                                   ok   (and the server exits)
+ *
+ * which mean just what the tools' own arguments and configs mean.  Inputs
+ * come from a volume_cache (see volume-cache.h), so repeated requests on a
+ * volume neither map nor decode it again, and automatic bounds reuse its
+ * histograms.  Results are files; outputs under /dev/shm are shared memory
+ * for the client to map.  Paths are taken relative to the server's
+ * directory, so clients should send absolute ones. */
+#ifndef TJF_SERVER_H
+#define TJF_SERVER_H
+
+#include <string>
+
+class volume_cache;
+
+/// the reply to 'request', without a newline.  never throws: failures are
+/// "error" replies.  sets 'quit' if the server should stop.
+std::string answer(volume_cache&, const std::string& request, bool& quit);
+
+#endif /* TJF_SERVER_H */
@@ -0,0 +1,183 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include "disjointset.h"
+#include "slab.h"
+#include "tasks.h"
+
+std::pair<uint64_t,uint64_t> slab_range(uint64_t depth, size_t n, size_t i)
+{
+  if(n == 0 || i >= n) { throw std::out_of_range("invalid slab index"); }
+  // the first 'depth % n' slabs get one extra slice.
+  const uint64_t per = depth / n;
+  const uint64_t extra = depth % n;
+  const uint64_t z0 = i*per + std::min<uint64_t>(i, extra);
+  const uint64_t z1 = z0 + per + (i < extra ? 1 : 0);
+  return std::make_pair(z0, z1);
+}
+
+std::string slab_fn(std::string base, size_t i)
+{
+  std::ostringstream fn;
+  fn << base << ".slab" << i;
+  return fn.str();
+}
+std::string slab_map_fn(std::string base, size_t i)
+{
+  return slab_fn(base, i) + ".map";
+}
+std::string slab_runs_fn(std::string base, size_t i)
+{
+  return slab_fn(base, i) + ".runs";
+}
+
+namespace {
+  void wr(std::ostream& os, uint64_t v) {
+    os.write(reinterpret_cast<const char*>(&v), sizeof(uint64_t));
+  }
+  void wr(std::ostream& os, const std::vector<uint64_t>& v) {
+    wr(os, v.size());
+    os.write(reinterpret_cast<const char*>(v.data()),
+             v.size()*sizeof(uint64_t));
+  }
+  uint64_t rd(std::istream& is) {
+    uint64_t v;
+    is.read(reinterpret_cast<char*>(&v), sizeof(uint64_t));
+    return v;
+  }
+  std::vector<uint64_t> rdv(std::istream& is) {
+    std::vector<uint64_t> v(rd(is));
+    is.read(reinterpret_cast<char*>(v.data()), v.size()*sizeof(uint64_t));
+    return v;
+  }
+  void wr(std::ostream& os, const std::vector<uint8_t>& v) {
+    wr(os, v.size());
+    os.write(reinterpret_cast<const char*>(v.data()), v.size());
+  }
+  std::vector<uint8_t> rdc(std::istream& is) {
+    std::vector<uint8_t> v(rd(is));
+    is.read(reinterpret_cast<char*>(v.data()), v.size());
+    return v;
+  }
+}
+
+void write_slab(std::string fn, const slab& s)
+{
+  std::ofstream ofs(fn.c_str(), std::ios::binary | std::ios::trunc);
+  wr(ofs, s.z0);
+  wr(ofs, s.z1);
+  wr(ofs, s.roots);
+  wr(ofs, s.classes);
+  wr(ofs, s.top);
+  wr(ofs, s.bottom);
+  if(!ofs) { throw std::runtime_error("could not write slab " + fn); }
+}
+
+slab read_slab(std::string fn)
+{
+  std::ifstream ifs(fn.c_str(), std::ios::binary);
+  slab s;
+  s.z0 = rd(ifs);
+  s.z1 = rd(ifs);
+  s.roots = rdv(ifs);
+  s.classes = rdc(ifs);
+  s.top = rdv(ifs);
+  s.bottom = rdv(ifs);
+  if(!ifs) { throw std::runtime_error("could not read slab " + fn); }
+  return s;
+}
+
+void write_map(std::string fn, const std::vector<uint64_t>& m)
+{
+  std::ofstream ofs(fn.c_str(), std::ios::binary | std::ios::trunc);
+  wr(ofs, m);
+  if(!ofs) { throw std::runtime_error("could not write map " + fn); }
+}
+
+std::vector<uint64_t> read_map(std::string fn)
+{
+  std::ifstream ifs(fn.c_str(), std::ios::binary);
+  std::vector<uint64_t> m = rdv(ifs);
+  if(!ifs) { throw std::runtime_error("could not read map " + fn); }
+  return m;
+}
+
+std::vector<std::vector<uint64_t>> merge_slabs(
+  const std::vector<slab>& slabs, uint64_t& n_components,
+  std::vector<uint8_t>* classes)
+{
+  // provisional labels are only unique within a slab; offset each slab's
+  // labels so they are unique globally.  since slabs are in z order, the
+  // global ids still increase in scan order.
+  std::vector<uint64_t> offset(slabs.size()+1, 0);
+  for(size_t s=0; s < slabs.size(); ++s) {
+    offset[s+1] = offset[s] + slabs[s].roots.size();
+  }
+
+  // the pairs of labels which touch across each boundary between slabs.
+  // faces are big but pairs are few, so find them in parallel and
+  // deduplicate before they go into the (serial) disjoint set.
+  std::vector<std::vector<std::pair<uint64_t,uint64_t>>> touch(slabs.size());
+  tasks::parallel_for(1, slabs.size(), 1, [&](uint64_t b, uint64_t e) {
+    for(uint64_t s=b; s < e; ++s) {
+      const slab& cur = slabs[s];
+      if(cur.z0 == cur.z1) { continue; } // empty slab: nothing to stitch.
+      size_t p = s;
+      do { --p; } while(p > 0 && slabs[p].z0 == slabs[p].z1);
+      if(slabs[p].z0 == slabs[p].z1) { continue; }
+      const slab& prev = slabs[p];
+      if(prev.bottom.size() != cur.top.size()) {
+        throw std::length_error("slab faces differ in size");
+      }
+      std::vector<std::pair<uint64_t,uint64_t>>& t = touch[s];
+      for(uint64_t i=0; i < cur.top.size(); ++i) {
+        if(prev.bottom[i] == 0 || cur.top[i] == 0 ||
+           prev.classes[prev.bottom[i]] != cur.classes[cur.top[i]]) {
+          continue;
+        }
+        const std::pair<uint64_t,uint64_t> pr(offset[p]+prev.bottom[i],
+                                              offset[s]+cur.top[i]);
+        if(t.empty() || t.back() != pr) { t.push_back(pr); }
+      }
+      std::sort(t.begin(), t.end());
+      t.erase(std::unique(t.begin(), t.end()), t.end());
+    }
+  });
+
+  DisjointSet ds;
+  ds.find(offset.back()); // allocate everything up front.
+  for(size_t s=0; s < slabs.size(); ++s) {
+    for(uint64_t p=1; p < slabs[s].roots.size(); ++p) {
+      ds.unio(offset[s]+p, offset[s]+slabs[s].roots[p]);
+    }
+    for(const std::pair<uint64_t,uint64_t>& pr : touch[s]) {
+      ds.unio(pr.first, pr.second);
+    }
+  }
+
+  // every set's root is its smallest id, i.e. the first one we'd meet
+  // walking in scan order; number the roots consecutively in that order.
+  std::vector<uint64_t> final_label(offset.back(), 0);
+  n_components = 0;
+  if(classes) { classes->assign(1, 0); }
+  for(size_t s=0; s < slabs.size(); ++s) {
+    for(uint64_t p=1; p < slabs[s].roots.size(); ++p) {
+      const uint64_t root = ds.find(offset[s]+p);
+      if(final_label[root] == 0) {
+        final_label[root] = ++n_components;
+        if(classes) { classes->push_back(slabs[s].classes[p]); }
+      }
+      final_label[offset[s]+p] = final_label[root];
+    }
+  }
+
+  std::vector<std::vector<uint64_t>> maps(slabs.size());
+  tasks::parallel_for(0, slabs.size(), 1, [&](uint64_t b, uint64_t e) {
+    for(uint64_t s=b; s < e; ++s) {
+      maps[s].assign(final_label.begin() + offset[s],
+                     final_label.begin() + offset[s+1]);
+    }
+  });
+  return maps;
+}
@@ -0,0 +1,49 @@
+/* Slab decomposition of a volume along z.  Every slab is labeled on its own,
+ * by a thread or by a separate process.  What ties the slabs together
+ * afterwards is only the labels on the first and last slice of each slab,
+ * plus each slab's local equivalences; those are small enough to ship
+ * around as files. */
+#ifndef TJF_SLAB_H
+#define TJF_SLAB_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct slab {
+  uint64_t z0, z1; ///< the slab covers slices [z0, z1)
+  /// local root of every provisional label.  roots[0] is background.
+  std::vector<uint64_t> roots;
+  /// class of every provisional label; labels only connect within a class.
+  std::vector<uint8_t> classes;
+  /// labels of the first and last slice, already resolved to local roots.
+  std::vector<uint64_t> top, bottom;
+};
+
+/// splits 'depth' slices into 'n' contiguous z ranges and gives the i'th.
+/// when there are more slabs than slices, the trailing slabs are empty.
+std::pair<uint64_t,uint64_t> slab_range(uint64_t depth, size_t n, size_t i);
+
+/// names for the per-slab files; they live next to 'base'.
+std::string slab_fn(std::string base, size_t i);
+std::string slab_map_fn(std::string base, size_t i);
+std::string slab_runs_fn(std::string base, size_t i);
+
+void write_slab(std::string fn, const slab&);
+slab read_slab(std::string fn);
+
+/// computes the global equivalences from the slabs' faces.  gives, for every
+/// slab, a table from provisional label to final label.  final labels are
+/// numbered from 1 in order of first appearance (in x,y,z scan order), so the
+/// result does not depend on how the volume was cut up.  if given, 'classes'
+/// gets the class of every final label.
+std::vector<std::vector<uint64_t>> merge_slabs(
+  const std::vector<slab>&, uint64_t& n_components,
+  std::vector<uint8_t>* classes=NULL
+);
+
+void write_map(std::string fn, const std::vector<uint64_t>&);
+std::vector<uint64_t> read_map(std::string fn);
+
+#endif /* TJF_SLAB_H */
@@ -0,0 +1,49 @@
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "f-nrrd.h"
+#include "mmap-memory.h"
+#include "smoothing.h"
+
+int main(int argc, char* argv[])
+{
+  if(argc != 6 && argc != 7) {
+    std::cerr << "Usage: " << argv[0] << " in-nhdr out-raw out-nhdr "
+              << "gaussian <sigma> | box <width> [float]\n"
+              << "  float: write floats instead of the input type\n";
+    return EXIT_FAILURE;
+  }
+  const bool as_float = argc == 7 && strcmp(argv[6], "float") == 0;
+  std::vector<float> kernel;
+  if(strcmp(argv[4], "gaussian") == 0) {
+    kernel = gaussian_kernel(std::strtod(argv[5], NULL));
+  } else if(strcmp(argv[4], "box") == 0) {
+    kernel = box_kernel(std::strtoul(argv[5], NULL, 10));
+  } else {
+    std::cerr << "unknown kernel '" << argv[4] << "'\n";
+    return EXIT_FAILURE;
+  }
+
+  nrrd n(argv[1]);
+  const std::array<uint64_t,3> dims = n.dimensions();
+  const uint64_t bytes = dims[0]*dims[1]*dims[2] * nrrd::bytes(n.datatype());
+  nrrd::write_header(argv[3], dims, as_float ? nrrd::FLOAT : n.datatype(),
+                     argv[2]);
+
+  std::ofstream out(argv[2], std::ios::out | std::ios::binary);
+  if(!out) {
+    std::cerr << "Could not open '" << argv[2] << "'\n";
+    return EXIT_FAILURE;
+  }
+  if(bytes == 0) { return EXIT_SUCCESS; }
+
+  memory in(n.datafile().c_str());
+  if(!in || in.length < bytes) {
+    std::cerr << "Cannot read " << n.datafile() << "\n";
+    return EXIT_FAILURE;
+  }
+  smooth(in.map, n.datatype(), dims, kernel, as_float, out);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <omp.h>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+#include "smoothing.h"
+
+std::vector<float> gaussian_kernel(double sigma)
+{
+  if(!(sigma > 0.0)) { throw std::invalid_argument("sigma must be > 0"); }
+  const int64_t r = static_cast<int64_t>(std::ceil(3.0 * sigma));
+  std::vector<float> k(2*r + 1);
+  double sum = 0.0;
+  for(int64_t i=-r; i <= r; ++i) {
+    sum += k[i+r] = static_cast<float>(std::exp(-0.5 * i*i / (sigma*sigma)));
+  }
+  for(float& w : k) { w = static_cast<float>(w / sum); }
+  return k;
+}
+
+std::vector<float> box_kernel(size_t width)
+{
+  if(width % 2 == 0) { throw std::invalid_argument("box width must be odd"); }
+  return std::vector<float>(width, 1.0f / width);
+}
+
+namespace {
+  // converts our float accumulators back to the output type.
+  template<typename O> O convert(float v, std::true_type) {
+    if(v <= static_cast<float>(std::numeric_limits<O>::lowest())) {
+      return std::numeric_limits<O>::lowest();
+    }
+    if(v >= static_cast<float>(std::numeric_limits<O>::max())) {
+      return std::numeric_limits<O>::max();
+    }
+    return static_cast<O>(std::nearbyint(v));
+  }
+  template<typename O> O convert(float v, std::false_type) {
+    return static_cast<O>(v);
+  }
+
+  // how many x positions the y pass works on at once.  every row of the
+  // block is contiguous, so we never stride through memory a voxel at a time.
+  const uint64_t xblock = 64;
+
+  // x and y passes of one slice: 'in' to 'out', using 'tmp' in between.
+  template<typename T>
+  void smooth_xy(const T* in, float* tmp, float* out,
+                 const std::array<uint64_t,3>& dims,
+                 const std::vector<float>& kernel) {
+    const int64_t r = kernel.size() / 2;
+    const int64_t nx = dims[0], ny = dims[1];
+
+    #pragma omp parallel
+    {
+      std::vector<float> pad(nx + 2*r);
+      #pragma omp for schedule(static)
+      for(int64_t y=0; y < ny; ++y) {
+        const T* row = in + y*nx;
+        for(int64_t i=0; i < nx + 2*r; ++i) {
+          pad[i] = static_cast<float>(row[std::min(std::max(i-r, int64_t(0)),
+                                                   nx-1)]);
+        }
+        float* o = tmp + y*nx;
+        std::fill(o, o+nx, 0.0f);
+        for(size_t k=0; k < kernel.size(); ++k) {
+          const float w = kernel[k];
+          const float* p = pad.data() + k;
+          for(int64_t x=0; x < nx; ++x) { o[x] += w * p[x]; }
+        }
+      }
+
+      const int64_t blocks = (nx + xblock - 1) / xblock;
+      #pragma omp for schedule(static)
+      for(int64_t bl=0; bl < blocks*ny; ++bl) {
+        const int64_t x0 = (bl % blocks) * xblock;
+        const int64_t y = bl / blocks;
+        const int64_t n = std::min<int64_t>(xblock, nx - x0);
+        float* o = out + y*nx + x0;
+        std::fill(o, o+n, 0.0f);
+        for(size_t k=0; k < kernel.size(); ++k) {
+          const int64_t yy = std::min(std::max(y + int64_t(k) - r,
+                                               int64_t(0)), ny-1);
+          const float w = kernel[k];
+          const float* src = tmp + yy*nx + x0;
+          for(int64_t x=0; x < n; ++x) { o[x] += w * src[x]; }
+        }
+      }
+    }
+  }
+
+  template<typename T, typename O>
+  void smooth_t(const T* in, const std::array<uint64_t,3>& dims,
+                const std::vector<float>& kernel, std::ostream& os) {
+    const uint64_t slice = dims[0]*dims[1];
+    const int64_t nz = dims[2];
+    if(slice == 0 || nz == 0) { return; }
+    const int64_t r = kernel.size() / 2;
+    const int64_t window = 2*r + 1;
+
+    // ring of slices which have been smoothed in x and y; slice s is in
+    // ring[s % window].
+    std::vector<std::vector<float>> ring(window, std::vector<float>(slice));
+    std::vector<float> tmp(slice);
+    std::vector<O> result(slice);
+
+    auto emit = [&](int64_t z) {
+      const int64_t n = slice;
+      #pragma omp parallel
+      {
+        std::vector<float> acc(xblock);
+        #pragma omp for schedule(static)
+        for(int64_t i0=0; i0 < n; i0 += xblock) {
+          const int64_t m = std::min<int64_t>(xblock, n - i0);
+          std::fill(acc.begin(), acc.end(), 0.0f);
+          for(int64_t k=0; k < window; ++k) {
+            const int64_t s = std::min(std::max(z + k - r, int64_t(0)), nz-1);
+            const float w = kernel[k];
+            const float* src = ring[s % window].data() + i0;
+            for(int64_t i=0; i < m; ++i) { acc[i] += w * src[i]; }
+          }
+          for(int64_t i=0; i < m; ++i) {
+            result[i0+i] = convert<O>(acc[i], std::is_integral<O>());
+          }
+        }
+      }
+      os.write(reinterpret_cast<const char*>(result.data()),
+               slice*sizeof(O));
+    };
+
+    for(int64_t z=0; z < nz; ++z) {
+      smooth_xy(in + z*slice, tmp.data(), ring[z % window].data(), dims,
+                kernel);
+      if(z >= r) { emit(z - r); }
+    }
+    for(int64_t z=std::max(nz - r, int64_t(0)); z < nz; ++z) { emit(z); }
+    if(!os) { throw std::runtime_error("error writing smoothed data"); }
+  }
+
+  template<typename T>
+  void smooth_as(const void* in, const std::array<uint64_t,3>& dims,
+                 const std::vector<float>& kernel, bool as_float,
+                 std::ostream& os) {
+    const T* data = static_cast<const T*>(in);
+    if(as_float) {
+      smooth_t<T,float>(data, dims, kernel, os);
+    } else {
+      smooth_t<T,T>(data, dims, kernel, os);
+    }
+  }
+}
+
+void smooth(const void* in, nrrd::dtype t, const std::array<uint64_t,3>& dims,
+            const std::vector<float>& k, bool flt, std::ostream& os)
+{
+  switch(t) {
+    case nrrd:: UINT8: smooth_as< uint8_t>(in, dims, k, flt, os); break;
+    case nrrd::UINT16: smooth_as<uint16_t>(in, dims, k, flt, os); break;
+    case nrrd::UINT32: smooth_as<uint32_t>(in, dims, k, flt, os); break;
+    case nrrd::UINT64: smooth_as<uint64_t>(in, dims, k, flt, os); break;
+    case nrrd:: INT8: smooth_as< int8_t>(in, dims, k, flt, os); break;
+    case nrrd::INT16: smooth_as<int16_t>(in, dims, k, flt, os); break;
+    case nrrd::INT32: smooth_as<int32_t>(in, dims, k, flt, os); break;
+    case nrrd::INT64: smooth_as<int64_t>(in, dims, k, flt, os); break;
+    case nrrd::FLOAT: smooth_as<float>(in, dims, k, flt, os); break;
+    case nrrd::DOUBLE: smooth_as<double>(in, dims, k, flt, os); break;
+    case nrrd::BIT: throw std::domain_error("bit masks are not supported");
+  }
+}
@@ -0,0 +1,27 @@
+/* Separable smoothing.  The volume is streamed through slice by slice: each
+ * slice is smoothed in x and y as it comes in, and the z pass runs over a
+ * window of the last few of those, so memory use does not grow with the
+ * depth of the volume. */
+#ifndef TJF_SMOOTHING_H
+#define TJF_SMOOTHING_H
+
+#include <array>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include "f-nrrd.h"
+
+/// normalized 1D kernels.  'gaussian' is the standard deviation, in voxels;
+/// it is truncated at 3 sigma.  'box' width must be odd.
+std::vector<float> gaussian_kernel(double sigma);
+std::vector<float> box_kernel(size_t width);
+
+/// smooths the x-fastest volume 'in', of type 't' and size 'dims', with
+/// 'kernel' along each axis; values outside the volume repeat the border.
+/// the result is written to 'out' as the input type (rounded and clamped)
+/// or, if 'as_float' is set, as floats.
+void smooth(const void* in, nrrd::dtype t, const std::array<uint64_t,3>& dims,
+            const std::vector<float>& kernel, bool as_float, std::ostream& out);
+
+#endif /* TJF_SMOOTHING_H */
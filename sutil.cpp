@@ -1,3 +1,5 @@
+#include <memory>
+#include <libgen.h>
 #include "sutil.h"
 
 std::string trim(const std::string s) {
@@ -12,3 +14,12 @@ std::string trim(const std::string s) {
     s.length() - std::distance(end, s.end())
   );
 }
+
+std::string dirname_fixed(std::string s)
+{
+  std::unique_ptr<char[]> dir(new char[s.length()+1]);
+  s.copy(dir.get(), s.length());
+  dir.get()[s.length()] = '\0';
+
+  return std::string(dirname(dir.get()));
+}
@@ -5,5 +5,8 @@
 #include <string>
 
 std::string trim(const std::string);
+// the default 'dirname' call modifies it's argument.  ridiculous.
+// this is the same thing with useful semantics.
+std::string dirname_fixed(std::string);
 
 #endif /* TJF_FILTERING_STRING_UTIL_H */
@@ -0,0 +1,263 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <pthread.h>
+#include <sched.h>
+#include <thread>
+#include <vector>
+#include "tasks.h"
+
+namespace {
+  // the tasks of one parallel_for.
+  struct group {
+    group() : pending(0), failed(false) {}
+    void fail(std::exception_ptr e) {
+      std::lock_guard<std::mutex> lk(this->m);
+      if(!this->err) { this->err = e; }
+      this->failed = true;
+    }
+    std::atomic<uint64_t> pending;
+    std::atomic<bool> failed;
+    std::mutex m;
+    std::exception_ptr err;
+  };
+
+  struct task {
+    std::function<void()> f;
+    group* g;
+  };
+
+  struct queue {
+    std::mutex m;
+    std::deque<task> q;
+  };
+
+  // index of the calling thread's queue.  threads outside the pool share
+  // queue 0.
+  thread_local size_t me = 0;
+
+  class pool {
+    public:
+      pool(size_t nthreads, bool pin);
+      ~pool();
+      size_t size() const { return this->queues.size(); }
+      void push(task t);
+      /// runs one task, ours or a stolen one; false if there were none.
+      bool run_one();
+      /// runs tasks until all of 'g' are done, sleeping while there are
+      /// none to run.
+      void wait(group& g);
+      /// takes (or gives back) every lock, around a fork().
+      void lock_all();
+      void unlock_all();
+
+    private:
+      void work(size_t i);
+      bool take(size_t q, bool back, task& t);
+
+      std::vector<std::unique_ptr<queue>> queues;
+      std::vector<std::thread> workers;
+      std::atomic<bool> stop;
+      std::atomic<uint64_t> queued;
+      std::mutex sleep;
+      std::condition_variable wake;
+  };
+
+  pool::pool(size_t nthreads, bool pin) : stop(false), queued(0) {
+    for(size_t i=0; i < nthreads; ++i) {
+      this->queues.emplace_back(new queue());
+    }
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    for(size_t i=1; i < nthreads; ++i) {
+      this->workers.emplace_back(&pool::work, this, i);
+      if(pin) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(i % cores, &set);
+        pthread_setaffinity_np(this->workers.back().native_handle(),
+                               sizeof(cpu_set_t), &set);
+      }
+    }
+  }
+
+  pool::~pool() {
+    {
+      std::lock_guard<std::mutex> lk(this->sleep);
+      this->stop = true;
+    }
+    this->wake.notify_all();
+    for(std::thread& w : this->workers) { w.join(); }
+  }
+
+  void pool::push(task t) {
+    queue& q = *this->queues[me];
+    {
+      std::lock_guard<std::mutex> lk(q.m);
+      q.q.push_back(t);
+    }
+    ++this->queued;
+    // taking the lock orders us after a worker's check of 'queued', so it
+    // cannot miss the notification.
+    { std::lock_guard<std::mutex> lk(this->sleep); }
+    this->wake.notify_one();
+  }
+
+  bool pool::take(size_t i, bool back, task& t) {
+    queue& q = *this->queues[i];
+    std::lock_guard<std::mutex> lk(q.m);
+    if(q.q.empty()) { return false; }
+    if(back) {
+      t = q.q.back();
+      q.q.pop_back();
+    } else {
+      t = q.q.front();
+      q.q.pop_front();
+    }
+    --this->queued;
+    return true;
+  }
+
+  bool pool::run_one() {
+    task t;
+    // our own newest task is the one most likely still in cache; from
+    // others we take the oldest, which is the biggest range.
+    bool found = this->take(me, true, t);
+    for(size_t k=1; !found && k < this->size(); ++k) {
+      found = this->take((me + k) % this->size(), false, t);
+    }
+    if(!found) { return false; }
+    if(!t.g->failed) {
+      try {
+        t.f();
+      } catch(...) {
+        t.g->fail(std::current_exception());
+      }
+    }
+    // the group may be gone once it is done, so don't touch it after.
+    if(--t.g->pending == 0) {
+      // as in push(): a waiter which saw it pending is asleep by now.
+      { std::lock_guard<std::mutex> lk(this->sleep); }
+      this->wake.notify_all();
+    }
+    return true;
+  }
+
+  void pool::wait(group& g) {
+    while(g.pending > 0) {
+      if(this->run_one()) { continue; }
+      std::unique_lock<std::mutex> lk(this->sleep);
+      this->wake.wait(lk, [&]() {
+        return g.pending == 0 || this->queued > 0;
+      });
+    }
+  }
+
+  void pool::lock_all() {
+    this->sleep.lock();
+    for(auto& q : this->queues) { q->m.lock(); }
+  }
+  void pool::unlock_all() {
+    for(auto& q : this->queues) { q->m.unlock(); }
+    this->sleep.unlock();
+  }
+
+  void pool::work(size_t i) {
+    me = i;
+    while(!this->stop) {
+      if(this->run_one()) { continue; }
+      std::unique_lock<std::mutex> lk(this->sleep);
+      this->wake.wait(lk, [this]() { return this->stop || this->queued > 0; });
+    }
+  }
+
+  std::mutex config;
+  std::unique_ptr<pool> global;
+
+  pool& get() {
+    std::lock_guard<std::mutex> lk(config);
+    if(!global) {
+      const char* n = getenv("TJF_THREADS");
+      const char* affinity = getenv("TJF_AFFINITY");
+      const size_t nthreads = n ? strtoul(n, NULL, 10) : 0;
+      global.reset(new pool(
+        nthreads > 0 ? nthreads :
+          std::max(1u, std::thread::hardware_concurrency()),
+        affinity && strcmp(affinity, "compact") == 0
+      ));
+    }
+    return *global;
+  }
+
+  // fork() copies only the calling thread, so a child would get a pool
+  // without workers, and perhaps locks held by them.  we hold every lock
+  // across the fork; the child then drops the pool (its threads are gone,
+  // so it must not join them) and starts its own on first use.
+  void prefork() {
+    config.lock();
+    if(global) { global->lock_all(); }
+  }
+  void postfork_parent() {
+    if(global) { global->unlock_all(); }
+    config.unlock();
+  }
+  void postfork_child() {
+    if(global) {
+      global->unlock_all();
+      global.release();
+    }
+    config.unlock();
+  }
+  const int atfork = pthread_atfork(prefork, postfork_parent, postfork_child);
+}
+
+namespace tasks {
+  size_t threads() { return get().size(); }
+
+  void configure(size_t nthreads, bool pin) {
+    std::lock_guard<std::mutex> lk(config);
+    global.reset(); // joins the old workers.
+    global.reset(new pool(
+      nthreads > 0 ? nthreads :
+        std::max(1u, std::thread::hardware_concurrency()),
+      pin
+    ));
+  }
+
+  void parallel_for(uint64_t begin, uint64_t end, uint64_t grain,
+                    const std::function<void(uint64_t,uint64_t)>& f) {
+    if(begin >= end) { return; }
+    grain = std::max<uint64_t>(grain, 1);
+    pool& p = get();
+    if(p.size() == 1 || end - begin <= grain) {
+      f(begin, end);
+      return;
+    }
+
+    group g;
+    // hand off the upper half until what is left is small, then do that.
+    std::function<void(uint64_t,uint64_t)> split = [&](uint64_t b,
+                                                       uint64_t e) {
+      while(e - b > grain) {
+        const uint64_t mid = b + (e-b)/2;
+        ++g.pending;
+        const task t = { [&split, mid, e]() { split(mid, e); }, &g };
+        p.push(t);
+        e = mid;
+      }
+      if(!g.failed) { f(b, e); }
+    };
+    try {
+      split(begin, end);
+    } catch(...) {
+      g.fail(std::current_exception());
+    }
+    p.wait(g);
+    if(g.err) { std::rethrow_exception(g.err); }
+  }
+}
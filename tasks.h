@@ -0,0 +1,34 @@
+/* A small work-stealing task pool.  Every worker owns a deque: it pushes and
+ * pops its own tasks at the back, while idle workers steal from the front of
+ * everybody else's.  parallel_for splits its range in halves, pushing one
+ * and working on the other, so a loop spreads over the workers as they run
+ * dry; a task may itself call parallel_for.  A thread waiting for its tasks
+ * keeps running tasks meanwhile, so nesting cannot deadlock; when there are
+ * none, it sleeps until one is pushed or its last task finishes.
+ *
+ * The pool is global.  By default it has one thread per core; the
+ * environment variables TJF_THREADS (a count) and TJF_AFFINITY ('compact'
+ * pins worker i to core i) override that, as does configure(). */
+#ifndef TJF_TASKS_H
+#define TJF_TASKS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace tasks {
+  /// the number of threads which run tasks, including the caller.
+  size_t threads();
+
+  /// rebuilds the pool with 'nthreads' threads (0: the default), pinned to
+  /// cores or not.  must not be called while anything runs in the pool.
+  void configure(size_t nthreads, bool pin);
+
+  /// calls f(b, e) on subranges [b,e) which cover [begin,end), in parallel.
+  /// ranges are not split below 'grain' elements.  if any call throws, the
+  /// remaining ranges may be skipped, and the first exception is rethrown.
+  void parallel_for(uint64_t begin, uint64_t end, uint64_t grain,
+                    const std::function<void(uint64_t,uint64_t)>& f);
+}
+
+#endif /* TJF_TASKS_H */
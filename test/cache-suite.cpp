@@ -0,0 +1,99 @@
+#include <array>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <cppunit/TestAssert.h>
+#include "cache-suite.h"
+#include "ccom.h"
+#include "f-nrrd.h"
+#include "volume-cache.h"
+
+namespace {
+  // a 4x2x2 uint8 volume, '.vol<n>.nhdr', with every voxel 'v'.
+  std::string write_volume(int n, uint8_t v) {
+    const std::string raw = ".vol" + std::to_string(n) + ".raw";
+    const std::string nhdr = ".vol" + std::to_string(n) + ".nhdr";
+    const std::vector<uint8_t> data(16, v);
+    std::ofstream(raw.c_str(), std::ios::binary).write(
+      reinterpret_cast<const char*>(data.data()), data.size()
+    );
+    nrrd::write_header(nhdr, {{4, 2, 2}}, nrrd::UINT8, raw);
+    return nhdr;
+  }
+
+  std::vector<char> readall(const char* fn) {
+    std::ifstream ifs(fn, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(ifs),
+                             std::istreambuf_iterator<char>());
+  }
+}
+
+void CacheSuite::tearDown() {
+  for(int n=0; n < 3; ++n) {
+    remove((".vol" + std::to_string(n) + ".raw").c_str());
+    remove((".vol" + std::to_string(n) + ".nhdr").c_str());
+  }
+  remove(".config");
+  remove(".outraw");
+  remove(".outnhdr");
+  remove(".resident");
+}
+
+// the least recently used volume goes first.
+void CacheSuite::test_lru() {
+  volume_cache cache(32);
+  const std::string a = write_volume(0, 1), b = write_volume(1, 2),
+                    c = write_volume(2, 3);
+  const std::shared_ptr<cached_volume> va = cache.get(a);
+  CPPUNIT_ASSERT(va->bytes() == 16 && va->dims()[2] == 2);
+  CPPUNIT_ASSERT(static_cast<const uint8_t*>(va->data())[15] == 1);
+  cache.get(b);
+  CPPUNIT_ASSERT(cache.get(a) == va); // ... which makes 'b' the oldest.
+  cache.get(c);
+  CPPUNIT_ASSERT(cache.size() == 2 && cache.bytes() == 32);
+  CPPUNIT_ASSERT(cache.get(a) == va);
+
+  // evicted, but still good while in use.
+  volume_cache small(16);
+  const std::shared_ptr<cached_volume> vb = small.get(b);
+  small.get(c);
+  CPPUNIT_ASSERT(small.size() == 1);
+  CPPUNIT_ASSERT(static_cast<const uint8_t*>(vb->data())[0] == 2);
+
+  // too big to keep at all.
+  volume_cache none(8);
+  CPPUNIT_ASSERT(none.get(a)->bytes() == 16 && none.size() == 0);
+}
+
+// a volume whose data changed is read again.
+void CacheSuite::test_stale() {
+  volume_cache cache(1024);
+  const std::string a = write_volume(0, 1);
+  const std::shared_ptr<cached_volume> v = cache.get(a);
+  CPPUNIT_ASSERT(cache.get(a) == v);
+  std::ofstream(".vol0.raw", std::ios::binary | std::ios::app).put(9);
+  const std::shared_ptr<cached_volume> w = cache.get(a);
+  CPPUNIT_ASSERT(w != v && cache.size() == 1 && cache.bytes() == 16);
+}
+
+// labeling a resident volume gives what labeling its files does.
+void CacheSuite::test_ccom() {
+  write_volume(0, 7);
+  for(const char* out : {".outraw", ".resident"}) {
+    std::ofstream(".config") << "in: .vol0.nhdr\noutraw: " << out << "\n"
+                             << "outnhdr: .outnhdr\n"
+                             << "component: { auto:p100 }\n";
+    if(std::string(out) == ".outraw") {
+      ccom(".config");
+      continue;
+    }
+    volume_cache cache(1024);
+    const ccom_stats st = ccom(".config", *cache.get(".vol0.nhdr"));
+    CPPUNIT_ASSERT(st.components == 1 && st.voxels[1] == 16);
+  }
+  const std::vector<char> expected = readall(".outraw");
+  CPPUNIT_ASSERT(expected.size() == 16 && expected[0] == 1);
+  CPPUNIT_ASSERT(readall(".resident") == expected);
+}
@@ -0,0 +1,13 @@
+#ifndef TJF_CACHE_SUITE_H
+#define TJF_CACHE_SUITE_H
+#include <cppunit/TestFixture.h>
+
+class CacheSuite : public CppUnit::TestFixture {
+  public:
+    virtual void tearDown();
+
+    void test_lru();
+    void test_stale();
+    void test_ccom();
+};
+#endif /* TJF_CACHE_SUITE_H */
@@ -3,8 +3,15 @@
 #include <fstream>
 #include <iostream>
 #include <cppunit/TestAssert.h>
+#include <vector>
 #include "ccom-suite.h"
+#include "bitmask.h"
 #include "ccom.h"
+#include "component-index.h"
+#include "f-nrrd.h"
+#include "tasks.h"
+#include "threshold.h"
+#include "volume.h"
 
 namespace {
   template<size_t N>
@@ -44,6 +51,12 @@ namespace {
     nhdr.close();
   }
 
+  std::vector<uint8_t> readall(const char* filename) {
+    std::ifstream ifs(filename, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(ifs),
+                                std::istreambuf_iterator<char>());
+  }
+
   bool at_eof(std::istream& is) {
     uint8_t v;
     is.read(reinterpret_cast<char*>(&v), sizeof(uint8_t));
@@ -78,6 +91,7 @@ void CComSuite::tearDown() {
   remove(".outnhdr");
   remove(".outraw");
 #endif
+  tasks::configure(0, false);
 }
 
 void CComSuite::test_empty() {
@@ -164,3 +178,394 @@ void CComSuite::test_2d_separate() {
   CPPUNIT_ASSERT(match<10>({{1,1,0,2,2,1,1,0,2,2}}, outraw));
   CPPUNIT_ASSERT(at_eof(outraw));
 }
+
+// a U shape: the two arms get separate labels until the bottom row joins them.
+// a 0 a
+// a a a
+void CComSuite::test_2d_merge() {
+  writearray<6,uint8_t>(".rawfile", {{3,0,3,3,3,3}});
+  wrnhdr(3, 2, 1);
+  ccom(".config");
+  std::ifstream outraw(".outraw", std::ios::binary);
+  CPPUNIT_ASSERT(match<6>({{1,0,1,1,1,1}}, outraw));
+  CPPUNIT_ASSERT(at_eof(outraw));
+}
+
+// labeling as separate slab processes must agree with labeling in one go.
+void CComSuite::test_slabs() {
+  // three components in a 3x2x5 volume: one snakes through every slice,
+  // one only connects through z and one is a single voxel.
+  writearray<30,uint8_t>(".rawfile", {{
+    1,0,0, 0,0,0,
+    1,1,0, 0,0,0,
+    0,1,0, 0,0,0,
+    0,1,0, 0,0,9,
+    0,1,0, 9,0,9,
+  }});
+  wrnhdr(3, 2, 5);
+  ccom(".config");
+  const std::vector<uint8_t> whole = readall(".outraw");
+  CPPUNIT_ASSERT(whole.size() == 30);
+  CPPUNIT_ASSERT(whole[0] == 1 && whole[25] == 1 && whole[29] == 2 &&
+                 whole[27] == 3);
+
+  for(size_t n=1; n <= 6; ++n) {
+    remove(".outraw");
+    for(size_t i=0; i < n; ++i) { ccom_label_slab(".config", i, n); }
+    ccom_merge(".config", n);
+    for(size_t i=0; i < n; ++i) { ccom_relabel_slab(".config", i, n); }
+    CPPUNIT_ASSERT(readall(".outraw") == whole);
+  }
+}
+
+// runs output must expand to the same labels as the raw output, whether it
+// comes from one process or from slabs.
+void CComSuite::test_runs() {
+  writearray<30,uint8_t>(".rawfile", {{
+    1,0,0, 0,0,0,
+    1,1,0, 0,0,0,
+    0,1,0, 0,0,0,
+    0,1,0, 0,0,9,
+    0,1,0, 9,0,9,
+  }});
+  wrnhdr(3, 2, 5);
+  ccom(".config");
+  const std::vector<uint8_t> whole = readall(".outraw");
+
+  std::ofstream cfg(".config", std::ios::app);
+  cfg << "outformat: runs\n";
+  cfg.close();
+  for(size_t n=0; n <= 4; ++n) {
+    remove(".outraw");
+    if(n == 0) {
+      ccom(".config");
+    } else {
+      for(size_t i=0; i < n; ++i) { ccom_label_slab(".config", i, n); }
+      ccom_merge(".config", n);
+      for(size_t i=0; i < n; ++i) { ccom_relabel_slab(".config", i, n); }
+    }
+    const run_file r(".outraw");
+    CPPUNIT_ASSERT(r.components() == 3);
+    CPPUNIT_ASSERT(r.index()[10] == 8); // one run per foreground scanline
+    std::vector<uint8_t> dense(30);
+    r.expand(dense.data());
+    CPPUNIT_ASSERT(dense == whole);
+    std::array<uint16_t,3> line;
+    r.scanline(1, 4, line.data());
+    CPPUNIT_ASSERT(line[0] == 3 && line[1] == 0 && line[2] == 2);
+  }
+}
+
+// the index must describe each component, for either output format.
+void CComSuite::test_index() {
+  writearray<30,uint8_t>(".rawfile", {{
+    1,0,0, 0,0,0,
+    1,1,0, 0,0,0,
+    0,1,0, 0,0,0,
+    0,1,0, 0,0,9,
+    0,1,0, 9,0,9,
+  }});
+  wrnhdr(3, 2, 5);
+  std::ofstream cfg(".config", std::ios::app);
+  cfg << "outindex: .outindex\n";
+  cfg.close();
+
+  for(const char* format : {"", "outformat: runs\n"}) {
+    std::ofstream(".config", std::ios::app) << format;
+    ccom(".config");
+    const index_file idx(".outindex");
+    CPPUNIT_ASSERT(idx.components() == 3);
+    // the snake: (0,0,0), (0,0,1), (1,0,1), then (1,0,z) up to z=4.
+    const component_entry& snake = idx.entry(1);
+    CPPUNIT_ASSERT(snake.voxels == 6 && snake.count == 5);
+    CPPUNIT_ASSERT(snake.lo[0] == 0 && snake.lo[1] == 0 && snake.lo[2] == 0);
+    CPPUNIT_ASSERT(snake.hi[0] == 2 && snake.hi[1] == 1 && snake.hi[2] == 5);
+    for(uint64_t z=0; z < 5; ++z) {
+      CPPUNIT_ASSERT(idx.scanlines(1)[z] == z*2);
+    }
+    // the column at (2,1,3..4).
+    const component_entry& col = idx.entry(2);
+    CPPUNIT_ASSERT(col.voxels == 2 && col.count == 2);
+    CPPUNIT_ASSERT(col.lo[0] == 2 && col.lo[1] == 1 && col.lo[2] == 3);
+    CPPUNIT_ASSERT(idx.scanlines(2)[0] == 7 && idx.scanlines(2)[1] == 9);
+    CPPUNIT_ASSERT(idx.entry(3).voxels == 1 && idx.entry(3).lo[2] == 4);
+    CPPUNIT_ASSERT_THROW(idx.entry(4), std::out_of_range);
+  }
+  remove(".outindex");
+}
+
+// the in-memory interface, on every other column of a larger 16bit buffer.
+void CComSuite::test_memory() {
+  // 6x2x1, of which we look at x = 0, 2, 4:  a 0 a / a 0 0  (with 'a' = 900)
+  const std::array<uint16_t,12> buf = {{900, 1, 0, 1, 900, 1,
+                                        900, 1, 0, 1,   0, 1}};
+  const std::array<uint64_t,3> dims = {{3, 2, 1}};
+  const std::array<uint64_t,3> strides = {{2, 6, 12}};
+  const std::vector<band<uint16_t>> component = {{800, 1000, 1}};
+  std::array<uint32_t,6> labels;
+  const ccom_stats st = ccom(buf.data(), dims, strides, component,
+                             labels.data());
+  const std::array<uint32_t,6> expected = {{1, 0, 2, 1, 0, 0}};
+  CPPUNIT_ASSERT(labels == expected);
+  CPPUNIT_ASSERT(st.components == 2);
+  CPPUNIT_ASSERT(st.voxels.size() == 3);
+  CPPUNIT_ASSERT(st.voxels[0] == 3 && st.voxels[1] == 2 && st.voxels[2] == 1);
+
+  // densely, the 1s bridge the 900s on either side of the zero column.
+  const std::array<uint64_t,3> all = {{6, 2, 1}};
+  const std::vector<band<uint16_t>> ones = {{1, 1, 1}, {900, 900, 1}};
+  std::array<uint8_t,12> l8;
+  const ccom_stats st8 = ccom(buf.data(), all, dense_strides(all), ones,
+                              l8.data());
+  CPPUNIT_ASSERT(st8.components == 2);
+  CPPUNIT_ASSERT(l8[0] == 1 && l8[7] == 1 && l8[3] == 2 && l8[11] == 2);
+
+  // and the same as runs.
+  run_volume v;
+  const ccom_stats str = ccom(buf.data(), all, dense_strides(all), ones, v);
+  CPPUNIT_ASSERT(str.components == 2 && str.voxels[0] == 3);
+  CPPUNIT_ASSERT(v.index.size() == 3 && v.runs.size() == 5);
+  std::array<uint8_t,12> expanded;
+  expand(v.dims, v.index.data(), v.runs.data(), expanded.data());
+  CPPUNIT_ASSERT(expanded == l8);
+}
+
+// a checkerboard of 320 components overflows 8 bit labels, though no slab
+// has more than 255 of its own.
+void CComSuite::test_overflow() {
+  const std::array<uint64_t,3> dims = {{80, 1, 8}};
+  std::vector<uint8_t> board(80*8);
+  for(size_t i=0; i < board.size(); ++i) { board[i] = (i%80 + i/80) % 2; }
+  const std::vector<band<uint8_t>> ones = {{1, 1, 1}};
+  tasks::configure(4, false);
+  std::vector<uint8_t> l8(board.size());
+  CPPUNIT_ASSERT_THROW(ccom(board.data(), dims, dense_strides(dims), ones,
+                            l8.data()), std::overflow_error);
+  std::vector<uint16_t> l16(board.size());
+  const ccom_stats st = ccom(board.data(), dims, dense_strides(dims), ones,
+                             l16.data());
+  CPPUNIT_ASSERT(st.components == 320);
+  for(size_t i=0; i < board.size(); ++i) {
+    CPPUNIT_ASSERT((l16[i] != 0) == (board[i] != 0));
+  }
+}
+
+// classes are labeled in one pass, but never connect to each other; not even
+// across slab faces.
+void CComSuite::test_classes() {
+  writearray<24,uint8_t>(".rawfile", {{
+    200, 40,0, 0,0,0,
+    200, 41,0, 0,0,0,
+     40,250,0, 0,0,0,
+     40,250,0, 0,0,0,
+  }});
+  wrnhdr(3, 2, 4);
+  std::ofstream cfg(".config");
+  cfg << "in: .nhdr\n"
+      << "outraw: .outraw\n"
+      << "outnhdr: .outnhdr\n"
+      << "component.bone: { range 200 256 }\n"
+      << "component.soft: { 40 41 42 }\n"
+      << "outclasses: .outclasses\n";
+  cfg.close();
+
+  const std::vector<uint8_t> expected = {{
+    1,2,0, 0,0,0,
+    1,2,0, 0,0,0,
+    3,4,0, 0,0,0,
+    3,4,0, 0,0,0,
+  }};
+  for(size_t n=0; n <= 4; ++n) {
+    remove(".outraw");
+    remove(".outclasses");
+    if(n == 0) {
+      ccom(".config");
+    } else {
+      for(size_t i=0; i < n; ++i) { ccom_label_slab(".config", i, n); }
+      ccom_merge(".config", n);
+      for(size_t i=0; i < n; ++i) { ccom_relabel_slab(".config", i, n); }
+    }
+    CPPUNIT_ASSERT(readall(".outraw") == expected);
+    std::ifstream table(".outclasses");
+    const std::string t((std::istreambuf_iterator<char>(table)),
+                        std::istreambuf_iterator<char>());
+    CPPUNIT_ASSERT(t == "1 bone\n2 soft\n3 soft\n4 bone\n");
+  }
+  remove(".outclasses");
+
+  // in memory, the band ids are the classes.
+  const std::array<uint64_t,3> dims = {{4, 1, 1}};
+  const std::array<uint8_t,4> in = {{5, 6, 6, 5}};
+  const std::vector<band<uint8_t>> bands = {{5, 5, 1}, {6, 6, 2}};
+  std::array<uint8_t,4> labels;
+  const ccom_stats st = ccom(in.data(), dims, dense_strides(dims), bands,
+                             labels.data());
+  const std::array<uint8_t,4> lexpected = {{1, 2, 2, 3}};
+  CPPUNIT_ASSERT(labels == lexpected && st.components == 3);
+  CPPUNIT_ASSERT(st.classes.size() == 4 && st.classes[1] == 1 &&
+                 st.classes[2] == 2 && st.classes[3] == 1);
+
+  // a value may only belong to one class.
+  std::ofstream(".config", std::ios::app) << "component.more: { 41 }\n";
+  CPPUNIT_ASSERT_THROW(ccom(".config"), std::invalid_argument);
+}
+
+// a mask labels just as the values it came from.
+void CComSuite::test_mask() {
+  // wider than a word, so runs and overlaps cross word boundaries.
+  const std::array<uint64_t,3> dims = {{130, 6, 5}};
+  const uint64_t n = dims[0]*dims[1]*dims[2];
+  std::vector<uint8_t> in(n);
+  uint32_t seed = 7;
+  for(uint64_t i=0; i < n; ++i) {
+    seed = seed*1103515245u + 12345u;
+    in[i] = (seed >> 16) % 3 == 0 ? 0 : 10;
+  }
+  std::vector<uint64_t> mask(mask_bytes(dims) / sizeof(uint64_t));
+  threshold_mask(in.data(), dims, dense_strides(dims), uint8_t(1),
+                 uint8_t(255), mask.data());
+  std::vector<uint8_t> row(dims[0]);
+  unpack_row(mask.data() + mask_words(dims[0]), dims[0], row.data());
+  for(uint64_t x=0; x < dims[0]; ++x) {
+    CPPUNIT_ASSERT(row[x] == (in[dims[0] + x] != 0));
+  }
+
+  const std::vector<band<uint8_t>> bands = {{1, 255, 1}};
+  std::vector<uint32_t> expected(n), labels(n);
+  const ccom_stats st = ccom(in.data(), dims, dense_strides(dims), bands,
+                             expected.data());
+  const ccom_stats mst = ccom_mask(mask.data(), dims, labels.data());
+  CPPUNIT_ASSERT(st.components > 1 && mst.components == st.components);
+  CPPUNIT_ASSERT(labels == expected && mst.voxels == st.voxels);
+
+  run_volume runs;
+  ccom_mask(mask.data(), dims, runs);
+  std::vector<uint32_t> expanded(n);
+  expand(runs.dims, runs.index.data(), runs.runs.data(), expanded.data());
+  CPPUNIT_ASSERT(expanded == expected);
+
+  // from a file, which needs no 'component'.
+  std::ofstream(".rawfile", std::ios::binary).write(
+    reinterpret_cast<const char*>(mask.data()), mask_bytes(dims)
+  );
+  std::ofstream(".nhdr") << "NRRD0002\ndimension: 3\ntype: bit\n"
+                         << "encoding: raw\ndata file: .rawfile\n"
+                         << "sizes: 130 6 5\n";
+  std::ofstream(".config") << "in: .nhdr\noutraw: .outraw\n"
+                           << "outnhdr: .outnhdr\nouttype: uint32\n";
+  for(size_t k=0; k <= 3; ++k) {
+    remove(".outraw");
+    if(k == 0) {
+      ccom(".config");
+    } else {
+      for(size_t i=0; i < k; ++i) { ccom_label_slab(".config", i, k); }
+      ccom_merge(".config", k);
+      for(size_t i=0; i < k; ++i) { ccom_relabel_slab(".config", i, k); }
+    }
+    const std::vector<uint8_t> out = readall(".outraw");
+    CPPUNIT_ASSERT(out.size() == n*sizeof(uint32_t) &&
+                   std::equal(out.begin(), out.end(),
+                              reinterpret_cast<const uint8_t*>(
+                                expected.data())));
+  }
+}
+
+// components are followed from one timestep to the next, through a merge.
+void CComSuite::test_series() {
+  const std::array<std::array<uint8_t,6>,3> steps = {{
+    {{1,1,0,0,1,1}},
+    {{0,1,1,0,1,0}},
+    {{1,1,1,1,1,0}},
+  }};
+  std::ofstream cfg(".config");
+  cfg << "series:";
+  for(size_t t=0; t < steps.size(); ++t) {
+    const std::string raw = ".step" + std::to_string(t) + ".raw";
+    const std::string nhdr = ".step" + std::to_string(t) + ".nhdr";
+    writearray<6,uint8_t>(raw.c_str(), steps[t]);
+    nrrd::write_header(nhdr, {{6, 1, 1}}, nrrd::UINT8, raw);
+    cfg << " " << nhdr;
+  }
+  cfg << "\noutraw: .out#.raw\noutnhdr: .out#.nhdr\n"
+      << "outtracks: .tracks##\ncomponent: { 1 }\n";
+  cfg.close();
+  ccom_series(".config");
+
+  const std::array<const char*,3> tables = {{
+    "# label voxels track previous:overlap...\n1 2 1\n2 2 2\n",
+    "# label voxels track previous:overlap...\n1 2 1 1:1\n2 1 2 2:1\n",
+    "# label voxels track previous:overlap...\n1 5 1 1:2 2:1\n",
+  }};
+  const std::array<std::vector<uint8_t>,3> labels = {{
+    {1,1,0,0,2,2}, {0,1,1,0,2,0}, {1,1,1,1,1,0}
+  }};
+  for(size_t t=0; t < steps.size(); ++t) {
+    const std::string n = std::to_string(t);
+    const std::vector<uint8_t> table = readall((".tracks0" + n).c_str());
+    CPPUNIT_ASSERT(std::string(table.begin(), table.end()) == tables[t]);
+    CPPUNIT_ASSERT(readall((".out" + n + ".raw").c_str()) == labels[t]);
+    remove((".tracks0" + n).c_str());
+    remove((".out" + n + ".raw").c_str());
+    remove((".out" + n + ".nhdr").c_str());
+    remove((".step" + n + ".raw").c_str());
+    remove((".step" + n + ".nhdr").c_str());
+  }
+}
+
+// a strided region labels just like a copy of it, in every mode.
+void CComSuite::test_roi() {
+  const std::array<uint64_t,3> dims = {{20, 12, 9}};
+  const uint64_t n = dims[0]*dims[1]*dims[2];
+  std::vector<uint8_t> in(n);
+  uint32_t seed = 11;
+  for(uint64_t i=0; i < n; ++i) {
+    seed = seed*1103515245u + 12345u;
+    in[i] = (seed >> 16) % 3 == 0 ? 0 : 10;
+  }
+  const roi r = parse_roi("3,2,1, 13,7,6, 2,1,3", dims);
+  const std::array<uint64_t,3> rdims = roi_dims(r);
+  CPPUNIT_ASSERT(rdims == (std::array<uint64_t,3>{{7, 7, 2}}));
+  std::vector<uint8_t> crop;
+  for(uint64_t z=0; z < rdims[2]; ++z) {
+    for(uint64_t y=0; y < rdims[1]; ++y) {
+      for(uint64_t x=0; x < rdims[0]; ++x) {
+        crop.push_back(in[(r.offset[2] + z*r.stride[2])*dims[0]*dims[1] +
+                          (r.offset[1] + y*r.stride[1])*dims[0] +
+                          r.offset[0] + x*r.stride[0]]);
+      }
+    }
+  }
+  const std::vector<band<uint8_t>> bands = {{10, 10, 1}};
+  std::vector<uint32_t> expected(crop.size());
+  ccom(crop.data(), rdims, dense_strides(rdims), bands, expected.data());
+
+  std::ofstream(".rawfile", std::ios::binary).write(
+    reinterpret_cast<const char*>(in.data()), n
+  );
+  nrrd::write_header(".nhdr", dims, nrrd::UINT8, ".rawfile");
+  std::ofstream(".config") << "in: .nhdr\noutraw: .outraw\n"
+                           << "outnhdr: .outnhdr\nouttype: uint32\n"
+                           << "component: { 10 }\nroi: 3 2 1 13 7 6 2 1 3\n";
+  for(size_t k=0; k <= 2; ++k) {
+    remove(".outraw");
+    if(k == 0) {
+      ccom(".config");
+    } else {
+      for(size_t i=0; i < k; ++i) { ccom_label_slab(".config", i, k); }
+      ccom_merge(".config", k);
+      for(size_t i=0; i < k; ++i) { ccom_relabel_slab(".config", i, k); }
+    }
+    const std::vector<uint8_t> out = readall(".outraw");
+    CPPUNIT_ASSERT(out.size() == crop.size()*sizeof(uint32_t) &&
+                   std::equal(out.begin(), out.end(),
+                              reinterpret_cast<const uint8_t*>(
+                                expected.data())));
+  }
+  const nrrd hdr(".outnhdr");
+  CPPUNIT_ASSERT(hdr.dimensions() == rdims);
+  const std::vector<uint8_t> h = readall(".outnhdr");
+  CPPUNIT_ASSERT(std::string(h.begin(), h.end()).find(
+                   "space origin: (3,2,1)\n") != std::string::npos);
+  remove(".rawfile"); remove(".nhdr"); remove(".config");
+  remove(".outraw"); remove(".outnhdr");
+}
@@ -16,5 +16,15 @@ class CComSuite : public CppUnit::TestFixture {
     void test_twovalues_merged();
     void test_twovalues_separate();
     void test_2d_separate();
+    void test_2d_merge();
+    void test_slabs();
+    void test_runs();
+    void test_index();
+    void test_memory();
+    void test_overflow();
+    void test_classes();
+    void test_mask();
+    void test_series();
+    void test_roi();
 };
 #endif /* TJF_CCOM_SUITE_H */
@@ -0,0 +1,60 @@
+#include <array>
+#include <cppunit/TestAssert.h>
+#include <sstream>
+#include "classify-suite.h"
+#include "classify.h"
+#include "threshold.h"
+#include "volume.h"
+
+// 16bit data goes through the lookup table.
+void ClassifySuite::test_table() {
+  const classifier<int16_t> cls(parse_bands<int16_t>("-5 0 1; 200 300 2"));
+  const std::array<int16_t,6> in = {{-6, -5, 0, 1, 250, 300}};
+  std::array<uint8_t,6> out;
+  cls(in.data(), out.data(), in.size());
+  const std::array<uint8_t,6> expected = {{0, 1, 1, 0, 2, 2}};
+  CPPUNIT_ASSERT(out == expected);
+}
+
+// floats test every band instead.
+void ClassifySuite::test_float() {
+  const classifier<float> cls(parse_bands<float>("0 2.5 1; 10 11 2; 50 1e3 3"));
+  const std::array<float,8> in = {{-1.f, .5f, 1.f, 2.5f, 3.f, 10.f, 11.f,
+                                   100.f}};
+  std::array<uint8_t,8> out;
+  cls(in.data(), out.data(), in.size());
+  const std::array<uint8_t,8> expected = {{0, 1, 1, 1, 0, 2, 2, 3}};
+  CPPUNIT_ASSERT(out == expected);
+}
+
+void ClassifySuite::test_overlap() {
+  CPPUNIT_ASSERT_THROW(parse_bands<uint8_t>("5 10 1; 9 255 7"),
+                       std::invalid_argument);
+  CPPUNIT_ASSERT_THROW(parse_bands<uint8_t>("5 10 0"), std::invalid_argument);
+}
+
+// bounds beyond the type clamp to it, rather than wrapping around.
+void ClassifySuite::test_limits() {
+  std::istringstream b("200 256");
+  const std::pair<uint8_t,uint8_t> r = parse_range<uint8_t>(b);
+  CPPUNIT_ASSERT(r.first == 200 && r.second == 255);
+  const std::array<uint64_t,3> dims = {{4, 1, 1}};
+  const std::array<uint8_t,4> in = {{0, 199, 200, 255}};
+  std::array<uint8_t,4> out;
+  threshold(in.data(), dims, dense_strides(dims), r.first, r.second,
+            out.data());
+  const std::array<uint8_t,4> expected = {{0, 0, 200, 255}};
+  CPPUNIT_ASSERT(out == expected);
+
+  const std::vector<band<uint8_t>> wide = parse_bands<uint8_t>("0 300 1");
+  CPPUNIT_ASSERT(wide.size() == 1 && wide[0].lo == 0 && wide[0].hi == 255);
+  CPPUNIT_ASSERT_THROW(parse_bands<uint8_t>("300 400 1"),
+                       std::invalid_argument);
+  CPPUNIT_ASSERT_THROW(parse_bands<uint8_t>("-1 10 1"),
+                       std::invalid_argument);
+  CPPUNIT_ASSERT_THROW(parse_bands<uint8_t>("5 1 1"), std::invalid_argument);
+  std::istringstream neg("-1");
+  CPPUNIT_ASSERT_THROW(parse_value<uint16_t>(neg), std::invalid_argument);
+  std::istringstream big("70000");
+  CPPUNIT_ASSERT_THROW(parse_value<int16_t>(big), std::invalid_argument);
+}
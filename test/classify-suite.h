@@ -0,0 +1,12 @@
+#ifndef TJF_CLASSIFY_SUITE_H
+#define TJF_CLASSIFY_SUITE_H
+#include <cppunit/TestFixture.h>
+
+class ClassifySuite : public CppUnit::TestFixture {
+  public:
+    void test_table();
+    void test_float();
+    void test_overlap();
+    void test_limits();
+};
+#endif /* TJF_CLASSIFY_SUITE_H */
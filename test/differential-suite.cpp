@@ -0,0 +1,342 @@
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <cppunit/TestAssert.h>
+#include "bitmask.h"
+#include "ccom.h"
+#include "differential-suite.h"
+#include "runs.h"
+#include "slab.h"
+#include "tasks.h"
+#include "volume.h"
+
+namespace {
+  struct sample {
+    std::array<uint64_t,3> dims;
+    std::vector<uint8_t> v;
+    uint8_t lo, hi; ///< foreground is [lo, hi]
+    uint64_t voxels() const { return dims[0]*dims[1]*dims[2]; }
+    bool fg(size_t i) const { return lo <= v[i] && v[i] <= hi; }
+  };
+
+  // noise of varying density; sometimes only a few slices have anything in
+  // them, which is what unbalances the slabs.  up to 12 voxels a side, or
+  // 'maxx' along x.
+  sample random_volume(uint64_t maxx=12) {
+    sample s;
+    s.dims[0] = 1 + rand() % maxx;
+    s.dims[1] = 1 + rand() % 12;
+    s.dims[2] = 1 + rand() % 12;
+    s.v.resize(s.voxels());
+    for(uint8_t& e : s.v) { e = rand() % 10; }
+    if(rand() % 3 == 0) {
+      const uint64_t slice = s.dims[0]*s.dims[1];
+      for(uint64_t z=0; z < s.dims[2]; ++z) {
+        if(rand() % 4 != 0) {
+          std::fill(s.v.begin() + z*slice, s.v.begin() + (z+1)*slice, 0);
+        }
+      }
+    }
+    s.lo = 1 + rand() % 9;
+    s.hi = s.lo + rand() % (10 - s.lo);
+    return s;
+  }
+
+  // a 3D checkerboard: every voxel of even x+y+z is a component of its own.
+  sample checkerboard(const std::array<uint64_t,3>& dims) {
+    sample s;
+    s.dims = dims;
+    s.v.resize(s.voxels());
+    for(size_t i=0; i < s.v.size(); ++i) {
+      const uint64_t x = i % dims[0], y = i / dims[0] % dims[1],
+                     z = i / (dims[0]*dims[1]);
+      s.v[i] = (x + y + z) % 2 == 0;
+    }
+    s.lo = s.hi = 1;
+    return s;
+  }
+
+  // the foreground of 's' as a mask.
+  std::vector<uint64_t> pack(const sample& s) {
+    std::vector<uint64_t> mask(mask_bytes(s.dims) / sizeof(uint64_t));
+    std::vector<uint8_t> row(s.dims[0]);
+    for(uint64_t r=0; r < s.dims[1]*s.dims[2]; ++r) {
+      for(uint64_t x=0; x < s.dims[0]; ++x) { row[x] = s.fg(r*s.dims[0] + x); }
+      pack_row(row.data(), s.dims[0], mask.data() + r*mask_words(s.dims[0]));
+    }
+    return mask;
+  }
+
+  // writes 's' as the input of the file-based interface.
+  void write_input(const sample& s) {
+    std::ofstream(".diff.raw", std::ios::binary).write(
+      reinterpret_cast<const char*>(s.v.data()), s.v.size()
+    );
+    std::ofstream(".diff.nhdr") << "NRRD0002\n"
+                                << "dimension: 3\n"
+                                << "type: uint8\n"
+                                << "encoding: raw\n"
+                                << "sizes: " << s.dims[0] << " " << s.dims[1]
+                                << " " << s.dims[2] << "\n"
+                                << "data file: .diff.raw\n";
+  }
+
+  // the obvious labeler: a breadth first search over the 6-neighborhood,
+  // from every foreground voxel not yet labeled, in scan order.
+  std::vector<uint64_t> reference(const sample& s, uint64_t& components) {
+    const int64_t nx = s.dims[0], ny = s.dims[1], nz = s.dims[2];
+    std::vector<uint64_t> out(s.voxels(), 0);
+    components = 0;
+    for(size_t seed=0; seed < out.size(); ++seed) {
+      if(!s.fg(seed) || out[seed] != 0) { continue; }
+      out[seed] = ++components;
+      std::deque<size_t> queue(1, seed);
+      while(!queue.empty()) {
+        const size_t i = queue.front();
+        queue.pop_front();
+        const int64_t x = i % nx, y = i / nx % ny, z = i / (nx*ny);
+        const int64_t nbr[6][3] = {
+          {x-1,y,z}, {x+1,y,z}, {x,y-1,z}, {x,y+1,z}, {x,y,z-1}, {x,y,z+1}
+        };
+        for(const auto& n : nbr) {
+          if(n[0] < 0 || n[0] >= nx || n[1] < 0 || n[1] >= ny || n[2] < 0 ||
+             n[2] >= nz) { continue; }
+          const size_t j = (n[2]*ny + n[1])*nx + n[0];
+          if(s.fg(j) && out[j] == 0) {
+            out[j] = components;
+            queue.push_back(j);
+          }
+        }
+      }
+    }
+    return out;
+  }
+
+  // whether 'a' and 'b' cut the volume into the same components, no matter
+  // how either numbers them.
+  template<typename A, typename B>
+  bool isomorphic(const A* a, const B* b, size_t n) {
+    std::map<uint64_t,uint64_t> ab, ba;
+    for(size_t i=0; i < n; ++i) {
+      if((a[i] == 0) != (b[i] == 0)) { return false; }
+      if(a[i] == 0) { continue; }
+      const auto fwd = ab.insert(std::make_pair(a[i], b[i]));
+      const auto bwd = ba.insert(std::make_pair(b[i], a[i]));
+      if(fwd.first->second != b[i] || bwd.first->second != a[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // the stats must agree with the labels they came with.
+  template<typename L>
+  bool consistent(const ccom_stats& st, const L* labels, size_t n) {
+    std::vector<uint64_t> count(st.components+1, 0);
+    for(size_t i=0; i < n; ++i) {
+      if(labels[i] > st.components) { return false; }
+      ++count[labels[i]];
+    }
+    return count == st.voxels;
+  }
+
+  // 's' inside a larger buffer full of junk: every other x, padded rows and
+  // slices.
+  std::vector<uint8_t> embed(const sample& s,
+                             std::array<uint64_t,3>& strides) {
+    strides[0] = 2;
+    strides[1] = 2*s.dims[0] + 1;
+    strides[2] = strides[1]*s.dims[1] + 3;
+    std::vector<uint8_t> buf(strides[2]*s.dims[2]);
+    for(uint8_t& e : buf) { e = rand() % 10; }
+    for(uint64_t z=0; z < s.dims[2]; ++z) {
+      for(uint64_t y=0; y < s.dims[1]; ++y) {
+        for(uint64_t x=0; x < s.dims[0]; ++x) {
+          buf[z*strides[2] + y*strides[1] + x*strides[0]] =
+            s.v[(z*s.dims[1] + y)*s.dims[0] + x];
+        }
+      }
+    }
+    return buf;
+  }
+
+  const char* const files[] = {
+    ".diff.raw", ".diff.nhdr", ".diff.config", ".diff.out", ".diff.outnhdr"
+  };
+}
+
+void DifferentialSuite::tearDown() {
+  for(const char* f : files) { remove(f); }
+}
+
+// every in-memory engine, on every thread count.
+void DifferentialSuite::test_engines() {
+  srand(34);
+  for(size_t iter=0; iter < 150; ++iter) {
+    const sample s = random_volume();
+    uint64_t components;
+    const std::vector<uint64_t> ref = reference(s, components);
+    const std::vector<band<uint8_t>> bands = {{s.lo, s.hi, 1}};
+    const size_t n = s.voxels();
+
+    for(size_t t : {1, 2, 3, 8}) {
+      tasks::configure(t, false);
+
+      std::vector<uint32_t> l32(n);
+      const ccom_stats st32 = ccom(s.v.data(), s.dims,
+                                   dense_strides(s.dims), bands, l32.data());
+      CPPUNIT_ASSERT(st32.components == components);
+      CPPUNIT_ASSERT(isomorphic(ref.data(), l32.data(), n));
+      CPPUNIT_ASSERT(consistent(st32, l32.data(), n));
+
+      std::vector<uint64_t> l64(n);
+      const ccom_stats st64 = ccom(s.v.data(), s.dims,
+                                   dense_strides(s.dims), bands, l64.data());
+      CPPUNIT_ASSERT(st64.components == components);
+      CPPUNIT_ASSERT(isomorphic(ref.data(), l64.data(), n));
+
+      run_volume rv;
+      const ccom_stats str = ccom(s.v.data(), s.dims, dense_strides(s.dims),
+                                  bands, rv);
+      std::vector<uint64_t> expanded(n);
+      expand(rv.dims, rv.index.data(), rv.runs.data(), expanded.data());
+      CPPUNIT_ASSERT(str.components == components);
+      CPPUNIT_ASSERT(isomorphic(ref.data(), expanded.data(), n));
+      CPPUNIT_ASSERT(consistent(str, expanded.data(), n));
+
+      std::array<uint64_t,3> strides;
+      const std::vector<uint8_t> buf = embed(s, strides);
+      std::vector<uint32_t> strided(n);
+      ccom(buf.data(), s.dims, strides, bands, strided.data());
+      CPPUNIT_ASSERT(strided == l32);
+    }
+  }
+  tasks::configure(0, false);
+}
+
+// the file-based phases, as separate slab processes would run them.
+void DifferentialSuite::test_processes() {
+  srand(35);
+  for(size_t iter=0; iter < 40; ++iter) {
+    const sample s = random_volume();
+    uint64_t components;
+    const std::vector<uint64_t> ref = reference(s, components);
+    write_input(s);
+
+    for(const char* format : {"raw", "runs"}) {
+      std::ofstream(".diff.config") << "in: .diff.nhdr\n"
+                                    << "outraw: .diff.out\n"
+                                    << "outnhdr: .diff.outnhdr\n"
+                                    << "outtype: uint32\n"
+                                    << "outformat: " << format << "\n"
+                                    << "component: { range " << int(s.lo)
+                                    << " " << int(s.hi)+1 << " }\n";
+      const size_t nslabs = 1 + rand() % (s.dims[2] + 2);
+      remove(".diff.out");
+      for(size_t i=0; i < nslabs; ++i) {
+        ccom_label_slab(".diff.config", i, nslabs);
+      }
+      ccom_merge(".diff.config", nslabs);
+      for(size_t i=0; i < nslabs; ++i) {
+        ccom_relabel_slab(".diff.config", i, nslabs);
+      }
+
+      std::vector<uint32_t> labels(s.voxels());
+      if(std::string(format) == "runs") {
+        const run_file r(".diff.out");
+        CPPUNIT_ASSERT(r.components() == components);
+        r.expand(labels.data());
+      } else {
+        std::ifstream(".diff.out", std::ios::binary).read(
+          reinterpret_cast<char*>(labels.data()),
+          labels.size()*sizeof(uint32_t)
+        );
+      }
+      CPPUNIT_ASSERT(isomorphic(ref.data(), labels.data(), labels.size()));
+    }
+  }
+}
+
+// masks, wide enough to span several words per scanline.
+void DifferentialSuite::test_mask() {
+  srand(36);
+  for(size_t iter=0; iter < 100; ++iter) {
+    const sample s = random_volume(200);
+    uint64_t components;
+    const std::vector<uint64_t> ref = reference(s, components);
+    const std::vector<uint64_t> mask = pack(s);
+    const size_t n = s.voxels();
+
+    for(size_t t : {1, 2, 3, 8}) {
+      tasks::configure(t, false);
+
+      std::vector<uint32_t> l32(n);
+      const ccom_stats st = ccom_mask(mask.data(), s.dims, l32.data());
+      CPPUNIT_ASSERT(st.components == components);
+      CPPUNIT_ASSERT(isomorphic(ref.data(), l32.data(), n));
+      CPPUNIT_ASSERT(consistent(st, l32.data(), n));
+
+      run_volume rv;
+      const ccom_stats str = ccom_mask(mask.data(), s.dims, rv);
+      std::vector<uint32_t> expanded(n);
+      expand(rv.dims, rv.index.data(), rv.runs.data(), expanded.data());
+      CPPUNIT_ASSERT(str.components == components);
+      CPPUNIT_ASSERT(expanded == l32);
+    }
+  }
+  tasks::configure(0, false);
+}
+
+// narrow labels right at their limit: one component more than they hold
+// throws, whichever slab it falls into, rather than wrapping around.
+void DifferentialSuite::test_narrow() {
+  const sample full8 = checkerboard({{10, 17, 3}}); // 255 components
+  const sample over8 = checkerboard({{16, 16, 2}}); // 256
+  const sample over16 = checkerboard({{64, 64, 33}}); // 67584
+  const std::vector<band<uint8_t>> bands = {{1, 1, 1}};
+  for(size_t t : {1, 2, 3, 8}) {
+    tasks::configure(t, false);
+
+    uint64_t components;
+    const std::vector<uint64_t> ref = reference(full8, components);
+    CPPUNIT_ASSERT(components == 255);
+    std::vector<uint8_t> l8(full8.voxels());
+    const ccom_stats st = ccom(full8.v.data(), full8.dims,
+                               dense_strides(full8.dims), bands, l8.data());
+    CPPUNIT_ASSERT(st.components == 255);
+    CPPUNIT_ASSERT(isomorphic(ref.data(), l8.data(), l8.size()));
+
+    l8.resize(over8.voxels());
+    CPPUNIT_ASSERT_THROW(ccom(over8.v.data(), over8.dims,
+                              dense_strides(over8.dims), bands, l8.data()),
+                         std::overflow_error);
+    const std::vector<uint64_t> mask = pack(over8);
+    CPPUNIT_ASSERT_THROW(ccom_mask(mask.data(), over8.dims, l8.data()),
+                         std::overflow_error);
+
+    std::vector<uint16_t> l16(over16.voxels());
+    CPPUNIT_ASSERT_THROW(ccom(over16.v.data(), over16.dims,
+                              dense_strides(over16.dims), bands, l16.data()),
+                         std::overflow_error);
+  }
+  tasks::configure(0, false);
+
+  // the merge of separate slab processes sees all of them.
+  write_input(over8);
+  std::ofstream(".diff.config") << "in: .diff.nhdr\n"
+                                << "outraw: .diff.out\n"
+                                << "outnhdr: .diff.outnhdr\n"
+                                << "outtype: uint8\n"
+                                << "component: { range 1 2 }\n";
+  for(size_t i=0; i < 2; ++i) { ccom_label_slab(".diff.config", i, 2); }
+  CPPUNIT_ASSERT_THROW(ccom_merge(".diff.config", 2), std::overflow_error);
+  for(size_t i=0; i < 2; ++i) {
+    remove(slab_fn(".diff.out", i).c_str());
+  }
+}
@@ -0,0 +1,16 @@
+#ifndef TJF_DIFFERENTIAL_SUITE_H
+#define TJF_DIFFERENTIAL_SUITE_H
+#include <cppunit/TestFixture.h>
+
+// compares every ccom engine against a simple reference labeler, on random
+// volumes.
+class DifferentialSuite : public CppUnit::TestFixture {
+  public:
+    virtual void tearDown();
+
+    void test_engines();
+    void test_processes();
+    void test_mask();
+    void test_narrow();
+};
+#endif /* TJF_DIFFERENTIAL_SUITE_H */
@@ -0,0 +1,79 @@
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include <cppunit/TestAssert.h>
+#include "distance-suite.h"
+#include "distance.h"
+
+namespace {
+  const std::array<uint64_t,3> dims = {{9, 7, 5}};
+
+  // distance to the closest outside voxel, by looking at all of them.
+  std::vector<uint32_t> brute(const std::vector<uint8_t>& v, int label) {
+    std::vector<uint32_t> out(v.size(), 0);
+    auto inside = [&](size_t i) {
+      return label < 0 ? v[i] != 0 : v[i] == label;
+    };
+    const int64_t nx = dims[0], ny = dims[1];
+    for(size_t i=0; i < v.size(); ++i) {
+      if(!inside(i)) { continue; }
+      uint32_t best = EDT_INFINITY;
+      for(size_t j=0; j < v.size(); ++j) {
+        if(inside(j)) { continue; }
+        const int64_t dx = int64_t(i % nx) - int64_t(j % nx);
+        const int64_t dy = int64_t(i / nx % ny) - int64_t(j / nx % ny);
+        const int64_t dz = int64_t(i / (nx*ny)) - int64_t(j / (nx*ny));
+        best = std::min<uint32_t>(best, dx*dx + dy*dy + dz*dz);
+      }
+      out[i] = best;
+    }
+    return out;
+  }
+
+  std::vector<uint8_t> blobs() {
+    std::vector<uint8_t> v(dims[0]*dims[1]*dims[2]);
+    srand(3);
+    for(uint8_t& e : v) { e = rand() % 5 == 0 ? 0 : 1 + rand() % 2; }
+    return v;
+  }
+}
+
+void DistanceSuite::test_reference() {
+  const std::vector<uint8_t> v = blobs();
+  std::vector<uint32_t> d(v.size());
+  squared_edt(v.data(), nrrd::UINT8, dims, -1, d.data());
+  CPPUNIT_ASSERT(d == brute(v, -1));
+
+  edt_sqrt(d.data(), d.size());
+  const std::vector<uint32_t> sq = brute(v, -1);
+  for(size_t i=0; i < d.size(); ++i) {
+    float f;
+    std::memcpy(&f, &d[i], sizeof(float));
+    CPPUNIT_ASSERT(f*f > sq[i] - 1e-3 && f*f < sq[i] + 1e-3);
+  }
+}
+
+void DistanceSuite::test_label() {
+  const std::vector<uint8_t> v = blobs();
+  std::vector<uint32_t> d(v.size());
+  squared_edt(v.data(), nrrd::UINT8, dims, 2, d.data());
+  CPPUNIT_ASSERT(d == brute(v, 2));
+}
+
+// 300 would be 44 as a uint8; that is some other object.
+void DistanceSuite::test_label_range() {
+  const std::vector<uint8_t> v = blobs();
+  std::vector<uint32_t> d(v.size());
+  CPPUNIT_ASSERT_THROW(squared_edt(v.data(), nrrd::UINT8, dims, 300,
+                                   d.data()), std::out_of_range);
+  squared_edt(v.data(), nrrd::UINT8, dims, 255, d.data());
+  CPPUNIT_ASSERT(d == brute(v, 255));
+}
+
+void DistanceSuite::test_no_outside() {
+  const std::vector<float> v(dims[0]*dims[1]*dims[2], 1.0f);
+  std::vector<uint32_t> d(v.size());
+  squared_edt(v.data(), nrrd::FLOAT, dims, -1, d.data());
+  CPPUNIT_ASSERT(d == std::vector<uint32_t>(v.size(), EDT_INFINITY));
+}
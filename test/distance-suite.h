@@ -0,0 +1,12 @@
+#ifndef TJF_DISTANCE_SUITE_H
+#define TJF_DISTANCE_SUITE_H
+#include <cppunit/TestFixture.h>
+
+class DistanceSuite : public CppUnit::TestFixture {
+  public:
+    void test_reference();
+    void test_label();
+    void test_label_range();
+    void test_no_outside();
+};
+#endif /* TJF_DISTANCE_SUITE_H */
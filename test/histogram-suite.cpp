@@ -0,0 +1,79 @@
+#include <array>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cppunit/TestAssert.h>
+#include "histogram-suite.h"
+#include "histogram.h"
+#include "threshold.h"
+#include "volume.h"
+
+namespace {
+  // 'lo' 'nlo' times followed by 'hi' 'nhi' times.
+  template<typename T> std::vector<T> twopeaks(T lo, size_t nlo, T hi,
+                                               size_t nhi) {
+    std::vector<T> v(nlo, lo);
+    v.insert(v.end(), nhi, hi);
+    return v;
+  }
+}
+
+void HistogramSuite::test_exact() {
+  const std::vector<uint8_t> v = twopeaks<uint8_t>(10, 700, 200, 300);
+  const histogram h = make_histogram(v.data(), v.size());
+  CPPUNIT_ASSERT(h.bins.size() == 256);
+  CPPUNIT_ASSERT(h.total() == 1000);
+  CPPUNIT_ASSERT(h.bins[10] == 700 && h.bins[200] == 300);
+  // anything in (10,200] separates the peaks.
+  CPPUNIT_ASSERT(10 < otsu(h) && otsu(h) <= 200);
+  CPPUNIT_ASSERT(percentile(h, 50.0) == 10.0);
+  CPPUNIT_ASSERT(percentile(h, 70.0) == 10.0);
+  CPPUNIT_ASSERT(percentile(h, 70.1) == 200.0);
+}
+
+void HistogramSuite::test_binned() {
+  const std::vector<float> v = twopeaks(-1.0f, 500, 3.0f, 500);
+  const histogram h = make_histogram(v.data(), v.size(), 1, 4);
+  CPPUNIT_ASSERT(h.bins.size() == 4);
+  CPPUNIT_ASSERT(h.lo == -1.0 && h.width == 1.0);
+  CPPUNIT_ASSERT(h.bins[0] == 500 && h.bins[3] == 500);
+  CPPUNIT_ASSERT(-1.0 < otsu(h) && otsu(h) <= 2.0);
+}
+
+void HistogramSuite::test_subsample() {
+  const std::vector<int16_t> v = twopeaks<int16_t>(-5, 400, 7, 400);
+  const histogram h = make_histogram(v.data(), v.size(), 8);
+  CPPUNIT_ASSERT(h.total() == 100);
+  CPPUNIT_ASSERT(h.bins[-5+32768] == 50 && h.bins[7+32768] == 50);
+}
+
+// the bins of wide integer types have fractional edges, so automatic bounds
+// do, too; threshold takes the values within them.
+void HistogramSuite::test_integer_bounds() {
+  const std::vector<uint32_t> v = twopeaks<uint32_t>(30, 700, 100000, 300);
+  const std::array<uint64_t,3> dims = {{v.size(), 1, 1}};
+  auto_bounds automatic([&v](uint64_t stride) {
+    return make_histogram(v.data(), v.size(), stride);
+  });
+  const std::string cut = automatic("auto:otsu");
+  CPPUNIT_ASSERT(cut.find('.') != std::string::npos);
+
+  const std::string specs[] = { cut + " 100000", "0 " + cut };
+  for(const std::string& spec : specs) {
+    threshold(dims, nrrd::UINT32, whole_roi(dims), THRESHOLD_VALUES, spec,
+              ".hraw", ".hnhdr", [&v](const slice_fn& apply) {
+      apply(v.data(), 0, 1);
+    });
+    std::vector<uint32_t> out(v.size());
+    std::ifstream ifs(".hraw", std::ios::binary);
+    ifs.read(reinterpret_cast<char*>(out.data()), out.size()*sizeof(uint32_t));
+    CPPUNIT_ASSERT(ifs);
+    const bool upper = spec == specs[0];
+    for(size_t i=0; i < v.size(); ++i) {
+      CPPUNIT_ASSERT(out[i] == ((v[i] == 100000) == upper ? v[i] : 0));
+    }
+  }
+  remove(".hraw");
+  remove(".hnhdr");
+}
@@ -0,0 +1,12 @@
+#ifndef TJF_HISTOGRAM_SUITE_H
+#define TJF_HISTOGRAM_SUITE_H
+#include <cppunit/TestFixture.h>
+
+class HistogramSuite : public CppUnit::TestFixture {
+  public:
+    void test_exact();
+    void test_binned();
+    void test_subsample();
+    void test_integer_bounds();
+};
+#endif /* TJF_HISTOGRAM_SUITE_H */
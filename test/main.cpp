@@ -3,7 +3,18 @@
 #include <cppunit/TestResult.h>
 #include <cppunit/TestSuite.h>
 #include <cppunit/ui/text/TestRunner.h>
+#include "cache-suite.h"
 #include "ccom-suite.h"
+#include "classify-suite.h"
+#include "differential-suite.h"
+#include "distance-suite.h"
+#include "histogram-suite.h"
+#include "morphology-suite.h"
+#include "server-suite.h"
+#include "smoothing-suite.h"
+#include "tasks-suite.h"
+#include "tiff-suite.h"
+#include "tree-suite.h"
 
 int main(int, char *[]) {
   CppUnit::TextUi::TestRunner runner;
@@ -21,6 +32,106 @@ int main(int, char *[]) {
                  &CComSuite::test_twovalues_separate));
   suite->addTest(new CppUnit::TestCaller<CComSuite>("test_2d_separate",
                  &CComSuite::test_2d_separate));
+  suite->addTest(new CppUnit::TestCaller<CComSuite>("test_2d_merge",
+                 &CComSuite::test_2d_merge));
+  suite->addTest(new CppUnit::TestCaller<CComSuite>("test_slabs",
+                 &CComSuite::test_slabs));
+  suite->addTest(new CppUnit::TestCaller<CComSuite>("test_runs",
+                 &CComSuite::test_runs));
+  suite->addTest(new CppUnit::TestCaller<CComSuite>("test_index",
+                 &CComSuite::test_index));
+  suite->addTest(new CppUnit::TestCaller<CComSuite>("test_memory",
+                 &CComSuite::test_memory));
+  suite->addTest(new CppUnit::TestCaller<CComSuite>("test_overflow",
+                 &CComSuite::test_overflow));
+  suite->addTest(new CppUnit::TestCaller<CComSuite>("test_classes",
+                 &CComSuite::test_classes));
+  suite->addTest(new CppUnit::TestCaller<CComSuite>("test_mask",
+                 &CComSuite::test_mask));
+  suite->addTest(new CppUnit::TestCaller<CComSuite>("test_series",
+                 &CComSuite::test_series));
+  suite->addTest(new CppUnit::TestCaller<CComSuite>("test_roi",
+                 &CComSuite::test_roi));
+  suite->addTest(new CppUnit::TestCaller<DifferentialSuite>("test_engines",
+                 &DifferentialSuite::test_engines));
+  suite->addTest(new CppUnit::TestCaller<DifferentialSuite>("test_processes",
+                 &DifferentialSuite::test_processes));
+  suite->addTest(new CppUnit::TestCaller<DifferentialSuite>("test_mask",
+                 &DifferentialSuite::test_mask));
+  suite->addTest(new CppUnit::TestCaller<DifferentialSuite>("test_narrow",
+                 &DifferentialSuite::test_narrow));
+  suite->addTest(new CppUnit::TestCaller<ClassifySuite>("test_table",
+                 &ClassifySuite::test_table));
+  suite->addTest(new CppUnit::TestCaller<ClassifySuite>("test_float",
+                 &ClassifySuite::test_float));
+  suite->addTest(new CppUnit::TestCaller<ClassifySuite>("test_overlap",
+                 &ClassifySuite::test_overlap));
+  suite->addTest(new CppUnit::TestCaller<ClassifySuite>("test_limits",
+                 &ClassifySuite::test_limits));
+  suite->addTest(new CppUnit::TestCaller<HistogramSuite>("test_exact",
+                 &HistogramSuite::test_exact));
+  suite->addTest(new CppUnit::TestCaller<HistogramSuite>("test_binned",
+                 &HistogramSuite::test_binned));
+  suite->addTest(new CppUnit::TestCaller<HistogramSuite>("test_subsample",
+                 &HistogramSuite::test_subsample));
+  suite->addTest(new CppUnit::TestCaller<HistogramSuite>(
+                 "test_integer_bounds", &HistogramSuite::test_integer_bounds));
+  suite->addTest(new CppUnit::TestCaller<MorphologySuite>("test_box",
+                 &MorphologySuite::test_box));
+  suite->addTest(new CppUnit::TestCaller<MorphologySuite>("test_cross",
+                 &MorphologySuite::test_cross));
+  suite->addTest(new CppUnit::TestCaller<MorphologySuite>("test_open_close",
+                 &MorphologySuite::test_open_close));
+  suite->addTest(new CppUnit::TestCaller<SmoothingSuite>("test_kernels",
+                 &SmoothingSuite::test_kernels));
+  suite->addTest(new CppUnit::TestCaller<SmoothingSuite>("test_reference",
+                 &SmoothingSuite::test_reference));
+  suite->addTest(new CppUnit::TestCaller<SmoothingSuite>("test_integer",
+                 &SmoothingSuite::test_integer));
+  suite->addTest(new CppUnit::TestCaller<DistanceSuite>("test_reference",
+                 &DistanceSuite::test_reference));
+  suite->addTest(new CppUnit::TestCaller<DistanceSuite>("test_label",
+                 &DistanceSuite::test_label));
+  suite->addTest(new CppUnit::TestCaller<DistanceSuite>("test_label_range",
+                 &DistanceSuite::test_label_range));
+  suite->addTest(new CppUnit::TestCaller<DistanceSuite>("test_no_outside",
+                 &DistanceSuite::test_no_outside));
+  suite->addTest(new CppUnit::TestCaller<TasksSuite>("test_cover",
+                 &TasksSuite::test_cover));
+  suite->addTest(new CppUnit::TestCaller<TasksSuite>("test_nested",
+                 &TasksSuite::test_nested));
+  suite->addTest(new CppUnit::TestCaller<TasksSuite>("test_exception",
+                 &TasksSuite::test_exception));
+  suite->addTest(new CppUnit::TestCaller<TiffSuite>("test_roundtrip",
+                 &TiffSuite::test_roundtrip));
+  suite->addTest(new CppUnit::TestCaller<TiffSuite>("test_stream",
+                 &TiffSuite::test_stream));
+  suite->addTest(new CppUnit::TestCaller<TiffSuite>("test_ccom",
+                 &TiffSuite::test_ccom));
+  suite->addTest(new CppUnit::TestCaller<TiffSuite>("test_histogram",
+                 &TiffSuite::test_histogram));
+  suite->addTest(new CppUnit::TestCaller<CacheSuite>("test_lru",
+                 &CacheSuite::test_lru));
+  suite->addTest(new CppUnit::TestCaller<CacheSuite>("test_stale",
+                 &CacheSuite::test_stale));
+  suite->addTest(new CppUnit::TestCaller<CacheSuite>("test_ccom",
+                 &CacheSuite::test_ccom));
+  suite->addTest(new CppUnit::TestCaller<ServerSuite>("test_ccom",
+                 &ServerSuite::test_ccom));
+  suite->addTest(new CppUnit::TestCaller<ServerSuite>("test_threshold",
+                 &ServerSuite::test_threshold));
+  suite->addTest(new CppUnit::TestCaller<ServerSuite>("test_stats",
+                 &ServerSuite::test_stats));
+  suite->addTest(new CppUnit::TestCaller<ServerSuite>("test_errors",
+                 &ServerSuite::test_errors));
+  suite->addTest(new CppUnit::TestCaller<TreeSuite>("test_nested",
+                 &TreeSuite::test_nested));
+  suite->addTest(new CppUnit::TestCaller<TreeSuite>("test_ccom",
+                 &TreeSuite::test_ccom));
+  suite->addTest(new CppUnit::TestCaller<TreeSuite>("test_empty",
+                 &TreeSuite::test_empty));
+  suite->addTest(new CppUnit::TestCaller<TreeSuite>("test_nan",
+                 &TreeSuite::test_nan));
   runner.addTest(suite);
   runner.run();
 }
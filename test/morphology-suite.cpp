@@ -0,0 +1,72 @@
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+#include <cppunit/TestAssert.h>
+#include "morphology-suite.h"
+#include "morphology.h"
+
+namespace {
+  const std::array<uint64_t,3> dims = {{7, 5, 6}};
+
+  std::vector<int16_t> noise() {
+    std::vector<int16_t> v(dims[0]*dims[1]*dims[2]);
+    srand(42);
+    for(auto& e : v) { e = static_cast<int16_t>(rand() % 200 - 100); }
+    return v;
+  }
+
+  // the obvious O(width^3) erosion/dilation, to compare against.
+  std::vector<int16_t> brute(const std::vector<int16_t>& v, bool erode,
+                             morph_shape shape, int64_t r) {
+    std::vector<int16_t> out(v.size());
+    const int64_t nx = dims[0], ny = dims[1], nz = dims[2];
+    for(int64_t z=0; z < nz; ++z) {
+      for(int64_t y=0; y < ny; ++y) {
+        for(int64_t x=0; x < nx; ++x) {
+          int16_t best = v[(z*ny + y)*nx + x];
+          for(int64_t k=-r; k <= r; ++k) {
+            for(int64_t j=-r; j <= r; ++j) {
+              for(int64_t i=-r; i <= r; ++i) {
+                const int zero = (i == 0) + (j == 0) + (k == 0);
+                if(shape == CROSS && zero < 2) { continue; }
+                if(x+i < 0 || x+i >= nx || y+j < 0 || y+j >= ny ||
+                   z+k < 0 || z+k >= nz) { continue; }
+                const int16_t n = v[((z+k)*ny + y+j)*nx + x+i];
+                best = erode ? std::min(best, n) : std::max(best, n);
+              }
+            }
+          }
+          out[(z*ny + y)*nx + x] = best;
+        }
+      }
+    }
+    return out;
+  }
+
+  void compare(morph_shape shape) {
+    const std::vector<int16_t> orig = noise();
+    for(size_t width=1; width <= 9; width += 2) {
+      std::vector<int16_t> v = orig;
+      morphology(v.data(), dims, ERODE, shape, width);
+      CPPUNIT_ASSERT(v == brute(orig, true, shape, width/2));
+      v = orig;
+      morphology(v.data(), dims, DILATE, shape, width);
+      CPPUNIT_ASSERT(v == brute(orig, false, shape, width/2));
+    }
+  }
+}
+
+void MorphologySuite::test_box() { compare(BOX); }
+void MorphologySuite::test_cross() { compare(CROSS); }
+
+void MorphologySuite::test_open_close() {
+  const std::vector<int16_t> orig = noise();
+  std::vector<int16_t> v = orig;
+  morphology(v.data(), dims, OPEN, BOX, 3);
+  CPPUNIT_ASSERT(v == brute(brute(orig, true, BOX, 1), false, BOX, 1));
+  v = orig;
+  morphology(v.data(), dims, CLOSE, CROSS, 5);
+  CPPUNIT_ASSERT(v == brute(brute(orig, false, CROSS, 2), true, CROSS, 2));
+  CPPUNIT_ASSERT_THROW(morphology(v.data(), dims, OPEN, BOX, 4),
+                       std::invalid_argument);
+}
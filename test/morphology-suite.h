@@ -0,0 +1,11 @@
+#ifndef TJF_MORPHOLOGY_SUITE_H
+#define TJF_MORPHOLOGY_SUITE_H
+#include <cppunit/TestFixture.h>
+
+class MorphologySuite : public CppUnit::TestFixture {
+  public:
+    void test_box();
+    void test_cross();
+    void test_open_close();
+};
+#endif /* TJF_MORPHOLOGY_SUITE_H */
@@ -0,0 +1,113 @@
+// throughput gate: fails when a filter gets slower than its recorded
+// baseline.  baselines are per machine, so they are not checked in; the
+// first run (or 'perf record') writes them.
+//
+// usage: perf [tolerance]     tolerance defaults to 0.2, i.e. 20% slower
+//        perf record
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include "ccom.h"
+#include "threshold.h"
+#include "volume.h"
+
+namespace {
+  const char* baseline_fn = "perf-baseline";
+  const std::array<uint64_t,3> dims = {{256, 256, 128}};
+
+  // balls of foreground in mild noise; more like our data than pure noise.
+  std::vector<uint8_t> balls() {
+    std::vector<uint8_t> v(dims[0]*dims[1]*dims[2]);
+    srand(7);
+    for(uint8_t& e : v) { e = rand() % 40; }
+    for(size_t b=0; b < 60; ++b) {
+      const int64_t cx = rand() % dims[0], cy = rand() % dims[1],
+                    cz = rand() % dims[2], r = 4 + rand() % 20;
+      for(int64_t z=std::max<int64_t>(0, cz-r);
+          z < std::min<int64_t>(dims[2], cz+r+1); ++z) {
+        for(int64_t y=std::max<int64_t>(0, cy-r);
+            y < std::min<int64_t>(dims[1], cy+r+1); ++y) {
+          for(int64_t x=std::max<int64_t>(0, cx-r);
+              x < std::min<int64_t>(dims[0], cx+r+1); ++x) {
+            const int64_t d = (x-cx)*(x-cx) + (y-cy)*(y-cy) + (z-cz)*(z-cz);
+            if(d <= r*r) { v[(z*dims[1] + y)*dims[0] + x] = 200; }
+          }
+        }
+      }
+    }
+    return v;
+  }
+
+  // voxels per second of 'f', the best of a few runs.
+  double rate(std::function<void()> f) {
+    double best = 0.0;
+    for(size_t i=0; i < 5; ++i) {
+      const auto t0 = std::chrono::steady_clock::now();
+      f();
+      const std::chrono::duration<double> s =
+        std::chrono::steady_clock::now() - t0;
+      best = std::max(best, dims[0]*dims[1]*dims[2] / s.count());
+    }
+    return best;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  const bool record = argc > 1 && strcmp(argv[1], "record") == 0;
+  const double tolerance = argc > 1 && !record ? atof(argv[1]) : 0.2;
+
+  const std::vector<uint8_t> in = balls();
+  const std::array<uint64_t,3> strides = dense_strides(dims);
+  const std::vector<band<uint8_t>> component = {{100, 255, 1}};
+  std::vector<uint32_t> labels(in.size());
+  std::vector<uint8_t> thresholded(in.size());
+
+  std::map<std::string,double> now;
+  now["threshold"] = rate([&]() {
+    threshold<uint8_t>(in.data(), dims, strides, 100, 255, thresholded.data());
+  });
+  now["ccom"] = rate([&]() {
+    ccom(in.data(), dims, strides, component, labels.data());
+  });
+  now["ccom-runs"] = rate([&]() {
+    run_volume v;
+    ccom(in.data(), dims, strides, component, v);
+  });
+
+  std::map<std::string,double> base;
+  {
+    std::ifstream ifs(baseline_fn);
+    std::string name;
+    double r;
+    while(ifs >> name >> r) { base[name] = r; }
+  }
+
+  bool ok = true;
+  for(const auto& n : now) {
+    std::cout << n.first << ": " << n.second / 1e6 << " Mvoxels/s";
+    if(!record && base.count(n.first)) {
+      const double change = n.second / base[n.first] - 1.0;
+      std::cout << " (" << (change >= 0 ? "+" : "") << change*100.0 << "%)";
+      if(change < -tolerance) {
+        std::cout << "  REGRESSION";
+        ok = false;
+      }
+    }
+    std::cout << "\n";
+  }
+
+  if(record || base.empty()) {
+    std::ofstream ofs(baseline_fn, std::ios::trunc);
+    for(const auto& n : now) { ofs << n.first << " " << n.second << "\n"; }
+    std::cout << "recorded baseline in " << baseline_fn << "\n";
+  }
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
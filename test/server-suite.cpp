@@ -0,0 +1,110 @@
+#include <array>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <cppunit/TestAssert.h>
+#include "f-nrrd.h"
+#include "server-suite.h"
+#include "server.h"
+#include "volume-cache.h"
+
+namespace {
+  // a 4x2x2 uint8 volume, '.srv.nhdr', of two components: 9 on x < 2, 3
+  // elsewhere but for a gap of zeros.
+  void write_volume() {
+    const std::array<uint8_t,16> data = {{
+      9, 9, 0, 3,  9, 9, 0, 3,
+      9, 9, 0, 3,  9, 9, 0, 3,
+    }};
+    std::ofstream(".srv.raw", std::ios::binary).write(
+      reinterpret_cast<const char*>(data.data()), data.size()
+    );
+    nrrd::write_header(".srv.nhdr", {{4, 2, 2}}, nrrd::UINT8, ".srv.raw");
+  }
+
+  std::vector<uint8_t> readall(const char* fn) {
+    std::ifstream ifs(fn, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(ifs),
+                                std::istreambuf_iterator<char>());
+  }
+}
+
+void ServerSuite::tearDown() {
+  for(const char* fn : {".srv.raw", ".srv.nhdr", ".config", ".outraw",
+                        ".outnhdr"}) {
+    remove(fn);
+  }
+}
+
+void ServerSuite::test_ccom() {
+  write_volume();
+  std::ofstream(".config") << "in: .srv.nhdr\noutraw: .outraw\n"
+                           << "outnhdr: .outnhdr\n"
+                           << "component: { range 1 256 }\n";
+  volume_cache cache(1024);
+  bool quit = false;
+  CPPUNIT_ASSERT(answer(cache, "ccom .config", quit) == "ok 2");
+  const std::vector<uint8_t> labels = readall(".outraw");
+  CPPUNIT_ASSERT(labels.size() == 16);
+  CPPUNIT_ASSERT(labels[0] == 1 && labels[2] == 0 && labels[3] == 2);
+  // the second time, from the cache.
+  CPPUNIT_ASSERT(answer(cache, "ccom .config", quit) == "ok 2");
+  CPPUNIT_ASSERT(cache.size() == 1 && !quit);
+}
+
+void ServerSuite::test_threshold() {
+  write_volume();
+  volume_cache cache(1024);
+  bool quit = false;
+  CPPUNIT_ASSERT(answer(cache, "threshold .srv.nhdr .outraw .outnhdr 5 255",
+                        quit) == "ok");
+  std::vector<uint8_t> out = readall(".outraw");
+  CPPUNIT_ASSERT(out.size() == 16 && out[0] == 9 && out[3] == 0);
+
+  CPPUNIT_ASSERT(answer(cache, "threshold .srv.nhdr .outraw .outnhdr "
+                               "bands 1 5 1; 6 9 2", quit) == "ok");
+  out = readall(".outraw");
+  CPPUNIT_ASSERT(out.size() == 16);
+  CPPUNIT_ASSERT(out[0] == 2 && out[2] == 0 && out[3] == 1);
+
+  CPPUNIT_ASSERT(answer(cache, "threshold .srv.nhdr .outraw .outnhdr "
+                               "auto:p100 auto:p100 mask", quit) == "ok");
+  CPPUNIT_ASSERT(nrrd(".outnhdr").datatype() == nrrd::BIT);
+  CPPUNIT_ASSERT(readall(".outraw").size() == 4*sizeof(uint64_t));
+}
+
+void ServerSuite::test_stats() {
+  write_volume();
+  volume_cache cache(1024);
+  bool quit = false;
+  CPPUNIT_ASSERT(answer(cache, "stats", quit) == "ok 0 0 1024");
+  CPPUNIT_ASSERT(answer(cache, "threshold .srv.nhdr .outraw .outnhdr 1 2",
+                        quit) == "ok");
+  CPPUNIT_ASSERT(answer(cache, "stats", quit) == "ok 1 16 1024");
+  CPPUNIT_ASSERT(answer(cache, "drop", quit) == "ok");
+  CPPUNIT_ASSERT(answer(cache, "stats", quit) == "ok 0 0 1024");
+  CPPUNIT_ASSERT(!quit);
+  CPPUNIT_ASSERT(answer(cache, "quit", quit) == "ok" && quit);
+}
+
+// failures are replies, and leave the server as it was.
+void ServerSuite::test_errors() {
+  write_volume();
+  volume_cache cache(1024);
+  bool quit = false;
+  CPPUNIT_ASSERT(answer(cache, "frobnicate", quit) ==
+                 "error unknown request 'frobnicate'");
+  CPPUNIT_ASSERT(answer(cache, "ccom", quit) == "error ccom needs a config");
+  CPPUNIT_ASSERT(answer(cache, "threshold .srv.nhdr .outraw", quit) ==
+                 "error threshold needs in, out-raw, out-nhdr and bounds");
+  CPPUNIT_ASSERT(answer(cache, "threshold .srv.nhdr .outraw .outnhdr 1",
+                        quit) == "error no upper bound");
+  CPPUNIT_ASSERT(answer(cache, "threshold .srv.nhdr .outraw .outnhdr 1 2 x",
+                        quit) == "error unknown option 'x'");
+  CPPUNIT_ASSERT(answer(cache, "threshold .nothere.nhdr .outraw .outnhdr 1 "
+                               "2", quit).compare(0, 6, "error ") == 0);
+  CPPUNIT_ASSERT(answer(cache, "stats", quit) == "ok 1 16 1024");
+  CPPUNIT_ASSERT(!quit);
+}
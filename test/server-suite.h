@@ -0,0 +1,14 @@
+#ifndef TJF_SERVER_SUITE_H
+#define TJF_SERVER_SUITE_H
+#include <cppunit/TestFixture.h>
+
+class ServerSuite : public CppUnit::TestFixture {
+  public:
+    virtual void tearDown();
+
+    void test_ccom();
+    void test_threshold();
+    void test_stats();
+    void test_errors();
+};
+#endif /* TJF_SERVER_SUITE_H */
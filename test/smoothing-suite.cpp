@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <numeric>
+#include <sstream>
+#include <vector>
+#include <cppunit/TestAssert.h>
+#include "smoothing-suite.h"
+#include "smoothing.h"
+
+namespace {
+  template<typename T> std::vector<T> read(const std::string& s) {
+    std::vector<T> v(s.size() / sizeof(T));
+    std::copy(s.begin(), s.end(), reinterpret_cast<char*>(v.data()));
+    return v;
+  }
+
+  // direct 3D convolution with a clamped border.
+  std::vector<float> brute(const std::vector<float>& v,
+                           const std::array<uint64_t,3>& dims,
+                           const std::vector<float>& k) {
+    const int64_t r = k.size()/2;
+    const int64_t nx = dims[0], ny = dims[1], nz = dims[2];
+    auto at = [&](int64_t x, int64_t y, int64_t z) {
+      x = std::min(std::max(x, int64_t(0)), nx-1);
+      y = std::min(std::max(y, int64_t(0)), ny-1);
+      z = std::min(std::max(z, int64_t(0)), nz-1);
+      return v[(z*ny + y)*nx + x];
+    };
+    std::vector<float> out(v.size());
+    for(int64_t z=0; z < nz; ++z) {
+      for(int64_t y=0; y < ny; ++y) {
+        for(int64_t x=0; x < nx; ++x) {
+          double acc = 0.0;
+          for(int64_t c=-r; c <= r; ++c) {
+            for(int64_t b=-r; b <= r; ++b) {
+              for(int64_t a=-r; a <= r; ++a) {
+                acc += k[a+r]*k[b+r]*k[c+r] * at(x+a, y+b, z+c);
+              }
+            }
+          }
+          out[(z*ny + y)*nx + x] = acc;
+        }
+      }
+    }
+    return out;
+  }
+}
+
+void SmoothingSuite::test_kernels() {
+  const std::vector<float> g = gaussian_kernel(1.5);
+  CPPUNIT_ASSERT(g.size() == 11);
+  CPPUNIT_ASSERT(std::fabs(std::accumulate(g.begin(), g.end(), 0.0) - 1.0) <
+                 1e-6);
+  CPPUNIT_ASSERT(g[4] == g[6] && g[5] > g[4]);
+  CPPUNIT_ASSERT(box_kernel(5).size() == 5);
+  CPPUNIT_ASSERT_THROW(box_kernel(4), std::invalid_argument);
+}
+
+// the blocked/streamed passes must agree with a plain 3D convolution; use
+// a volume wider than a block and deeper than the window.
+void SmoothingSuite::test_reference() {
+  const std::array<uint64_t,3> dims = {{70, 4, 9}};
+  std::vector<float> v(dims[0]*dims[1]*dims[2]);
+  srand(7);
+  for(float& f : v) { f = rand() % 1000 / 10.0f; }
+  for(double sigma : {0.5, 1.0}) {
+    const std::vector<float> k = gaussian_kernel(sigma);
+    std::ostringstream os;
+    smooth(v.data(), nrrd::FLOAT, dims, k, true, os);
+    const std::vector<float> got = read<float>(os.str());
+    const std::vector<float> expected = brute(v, dims, k);
+    CPPUNIT_ASSERT(got.size() == expected.size());
+    for(size_t i=0; i < got.size(); ++i) {
+      CPPUNIT_ASSERT(std::fabs(got[i] - expected[i]) < 1e-3);
+    }
+  }
+}
+
+// integer output is rounded; a constant volume stays constant.
+void SmoothingSuite::test_integer() {
+  const std::array<uint64_t,3> dims = {{5, 3, 2}};
+  const std::vector<uint8_t> v(30, 200);
+  std::ostringstream os;
+  smooth(v.data(), nrrd::UINT8, dims, box_kernel(3), false, os);
+  CPPUNIT_ASSERT(read<uint8_t>(os.str()) == v);
+}
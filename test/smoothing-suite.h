@@ -0,0 +1,11 @@
+#ifndef TJF_SMOOTHING_SUITE_H
+#define TJF_SMOOTHING_SUITE_H
+#include <cppunit/TestFixture.h>
+
+class SmoothingSuite : public CppUnit::TestFixture {
+  public:
+    void test_kernels();
+    void test_reference();
+    void test_integer();
+};
+#endif /* TJF_SMOOTHING_SUITE_H */
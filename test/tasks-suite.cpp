@@ -0,0 +1,58 @@
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+#include <cppunit/TestAssert.h>
+#include "tasks-suite.h"
+#include "tasks.h"
+
+void TasksSuite::tearDown() { tasks::configure(0, false); }
+
+// every index is visited exactly once.  with more than one thread, ranges
+// are cut down to at most 'grain'.
+void TasksSuite::test_cover() {
+  for(size_t t : {1, 4, 13}) {
+    tasks::configure(t, false);
+    CPPUNIT_ASSERT(tasks::threads() == t);
+    std::vector<std::atomic<int>> seen(10007);
+    for(std::atomic<int>& s : seen) { s = 0; }
+    std::atomic<bool> small(true);
+    tasks::parallel_for(3, seen.size(), 17, [&](uint64_t b, uint64_t e) {
+      if(e - b > 17) { small = false; }
+      for(uint64_t i=b; i < e; ++i) { ++seen[i]; }
+    });
+    CPPUNIT_ASSERT(small || t == 1);
+    CPPUNIT_ASSERT(seen[0] == 0 && seen[1] == 0 && seen[2] == 0);
+    for(size_t i=3; i < seen.size(); ++i) { CPPUNIT_ASSERT(seen[i] == 1); }
+  }
+}
+
+// loops inside of tasks must neither deadlock nor lose work.
+void TasksSuite::test_nested() {
+  tasks::configure(3, false);
+  std::atomic<uint64_t> sum(0);
+  tasks::parallel_for(0, 40, 1, [&](uint64_t b, uint64_t e) {
+    for(uint64_t i=b; i < e; ++i) {
+      tasks::parallel_for(0, 1000, 10, [&](uint64_t b2, uint64_t e2) {
+        for(uint64_t j=b2; j < e2; ++j) { sum += j; }
+      });
+    }
+  });
+  CPPUNIT_ASSERT(sum == 40 * (999*1000/2));
+}
+
+void TasksSuite::test_exception() {
+  tasks::configure(4, false);
+  bool caught = false;
+  try {
+    tasks::parallel_for(0, 1000, 1, [&](uint64_t b, uint64_t) {
+      if(b == 500) { throw std::runtime_error("500"); }
+    });
+  } catch(const std::runtime_error& e) {
+    caught = std::string(e.what()) == "500";
+  }
+  CPPUNIT_ASSERT(caught);
+  // ... and the pool still works afterwards.
+  std::atomic<uint64_t> n(0);
+  tasks::parallel_for(0, 100, 1, [&](uint64_t b, uint64_t e) { n += e-b; });
+  CPPUNIT_ASSERT(n == 100);
+}
@@ -0,0 +1,13 @@
+#ifndef TJF_TASKS_SUITE_H
+#define TJF_TASKS_SUITE_H
+#include <cppunit/TestFixture.h>
+
+class TasksSuite : public CppUnit::TestFixture {
+  public:
+    virtual void tearDown();
+
+    void test_cover();
+    void test_nested();
+    void test_exception();
+};
+#endif /* TJF_TASKS_SUITE_H */
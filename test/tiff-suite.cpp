@@ -0,0 +1,148 @@
+#include <array>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <unistd.h>
+#include <vector>
+#include <cppunit/TestAssert.h>
+#include "ccom.h"
+#include "component-index.h"
+#include "tasks.h"
+#include "tiff-stack.h"
+#include "tiff-suite.h"
+#include "volume.h"
+
+namespace {
+  const std::array<uint64_t,3> dims = {{5, 3, 4}};
+
+  std::vector<uint16_t> ramp() {
+    std::vector<uint16_t> v(dims[0]*dims[1]*dims[2]);
+    for(size_t i=0; i < v.size(); ++i) { v[i] = uint16_t(i*997); }
+    return v;
+  }
+}
+
+void TiffSuite::tearDown() {
+  tasks::configure(0, false);
+  remove(".stack.tif");
+  for(const char* s : {"slice0000.tif", "slice0001.tif", "slice0002.tif",
+                       "slice0003.tif"}) {
+    remove((std::string(".stack/") + s).c_str());
+  }
+  rmdir(".stack");
+  remove(".config");
+  remove(".labels.tif");
+}
+
+// what we write, we read back: as one file or as a directory of slices.
+void TiffSuite::test_roundtrip() {
+  const std::vector<uint16_t> v = ramp();
+  for(const char* path : {".stack.tif", ".stack/"}) {
+    write_tiff(path, dims, nrrd::UINT16, v.data());
+    CPPUNIT_ASSERT(is_tiff(path));
+    const tiff_stack s(path);
+    CPPUNIT_ASSERT(s.dims() == dims && s.type() == nrrd::UINT16);
+    std::vector<uint16_t> all(v.size());
+    s.read(0, dims[2], all.data());
+    CPPUNIT_ASSERT(all == v);
+    const uint64_t slice = dims[0]*dims[1];
+    std::vector<uint16_t> middle(2*slice);
+    s.read(1, 3, middle.data());
+    CPPUNIT_ASSERT(std::equal(middle.begin(), middle.end(),
+                              v.begin() + slice));
+  }
+  CPPUNIT_ASSERT(!is_tiff("tiff-suite.cpp"));
+
+  const std::vector<float> f = {{-1.5f, 0.0f, 2.25f, 1e30f}};
+  const std::array<uint64_t,3> fd = {{2, 1, 2}};
+  write_tiff(".stack.tif", fd, nrrd::FLOAT, f.data());
+  const tiff_stack fs(".stack.tif");
+  CPPUNIT_ASSERT(fs.type() == nrrd::FLOAT && fs.dims() == fd);
+  std::vector<float> back(4);
+  fs.read(0, 2, back.data());
+  CPPUNIT_ASSERT(back == f);
+}
+
+// slices arrive in order, however many decode ahead; errors get through.
+void TiffSuite::test_stream() {
+  const std::vector<uint16_t> v = ramp();
+  write_tiff(".stack.tif", dims, nrrd::UINT16, v.data());
+  const tiff_stack s(".stack.tif");
+  const uint64_t slice = dims[0]*dims[1];
+  for(size_t t : {1, 3}) {
+    tasks::configure(t, false);
+    for(size_t window : {1, 2, 16}) {
+      uint64_t expect = 1;
+      s.stream(1, dims[2], window, [&](uint64_t z, const void* data) {
+        CPPUNIT_ASSERT(z == expect++);
+        const uint16_t* d = static_cast<const uint16_t*>(data);
+        CPPUNIT_ASSERT(std::equal(d, d+slice, v.begin() + z*slice));
+      });
+      CPPUNIT_ASSERT(expect == dims[2]);
+    }
+    CPPUNIT_ASSERT_THROW(s.stream(0, dims[2], 2, [](uint64_t z, const void*) {
+      if(z == 1) { throw std::runtime_error("stop"); }
+    }), std::runtime_error);
+  }
+}
+
+// ccom reads a stack, and writes one, with the same labels as in memory.
+void TiffSuite::test_ccom() {
+  const std::array<uint64_t,3> d = {{3, 2, 3}};
+  const std::vector<uint8_t> in = {{
+    7,0,7, 0,0,7,
+    7,0,0, 0,0,0,
+    0,0,7, 7,7,7,
+  }};
+  write_tiff(".stack/", d, nrrd::UINT8, in.data());
+  std::ofstream cfg(".config");
+  cfg << "in: .stack\n"
+      << "outraw: .labels.tif\n"
+      << "outformat: tiff\n"
+      << "outindex: .index\n"
+      << "component: { auto:p100 }\n"; // the 7s, from the stack itself.
+  cfg.close();
+
+  std::vector<uint8_t> expected(in.size());
+  const std::vector<band<uint8_t>> bands = {{7, 7, 1}};
+  ccom(in.data(), d, dense_strides(d), bands, expected.data());
+  const component_index idx = index_components(expected.data(), d);
+  // one thread writes the stack a slice at a time.
+  for(size_t t : {1, 3}) {
+    tasks::configure(t, false);
+    remove(".labels.tif");
+    ccom(".config");
+    const tiff_stack labels(".labels.tif");
+    CPPUNIT_ASSERT(labels.dims() == d && labels.type() == nrrd::UINT8);
+    std::vector<uint8_t> got(in.size());
+    labels.read(0, d[2], got.data());
+    CPPUNIT_ASSERT(got == expected);
+    const index_file written(".index");
+    CPPUNIT_ASSERT(written.components() == idx.entries.size());
+    for(size_t l=1; l <= idx.entries.size(); ++l) {
+      CPPUNIT_ASSERT(written.entry(l).voxels == idx.entries[l-1].voxels);
+      CPPUNIT_ASSERT(written.entry(l).lo == idx.entries[l-1].lo);
+    }
+  }
+  remove(".index");
+}
+
+// a stack's histogram, built a slice at a time, is that of its data.
+void TiffSuite::test_histogram() {
+  std::vector<float> f(dims[0]*dims[1]*dims[2]);
+  for(size_t i=0; i < f.size(); ++i) { f[i] = float((i*37) % 23) - 4.5f; }
+  write_tiff(".stack.tif", dims, nrrd::FLOAT, f.data());
+  const tiff_stack fs(".stack.tif");
+  const std::vector<uint16_t> v = ramp();
+  write_tiff(".stack/", dims, nrrd::UINT16, v.data());
+  const tiff_stack vs(".stack/");
+  // strides within a slice, across slices, and beyond whole slices.
+  for(uint64_t stride : {1, 4, 16, 40}) {
+    const histogram a = make_histogram(fs, stride, 64);
+    const histogram b = make_histogram(f.data(), f.size(), stride, 64);
+    CPPUNIT_ASSERT(a.lo == b.lo && a.width == b.width && a.bins == b.bins);
+    const histogram c = make_histogram(vs, stride);
+    const histogram e = make_histogram(v.data(), v.size(), stride);
+    CPPUNIT_ASSERT(c.lo == e.lo && c.bins == e.bins);
+  }
+}
@@ -0,0 +1,14 @@
+#ifndef TJF_TIFF_SUITE_H
+#define TJF_TIFF_SUITE_H
+#include <cppunit/TestFixture.h>
+
+class TiffSuite : public CppUnit::TestFixture {
+  public:
+    virtual void tearDown();
+
+    void test_roundtrip();
+    void test_stream();
+    void test_ccom();
+    void test_histogram();
+};
+#endif /* TJF_TIFF_SUITE_H */
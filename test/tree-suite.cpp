@@ -0,0 +1,97 @@
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+#include <cppunit/TestAssert.h>
+#include "ccom.h"
+#include "component-tree.h"
+#include "tasks.h"
+#include "tree-suite.h"
+#include "volume.h"
+
+void TreeSuite::tearDown() {
+  tasks::configure(0, false);
+  remove(".tree");
+  remove(".stree");
+  remove(".ftree");
+}
+
+// two peaks on a plateau: one component below the saddle, two above it.
+void TreeSuite::test_nested() {
+  const std::array<uint64_t,3> dims = {{7, 1, 1}};
+  const std::array<uint8_t,7> v = {{1, 5, 3, 2, 4, 4, 1}};
+  write_tree(".tree", build_component_tree(v.data(), dims));
+  const tree_file t(".tree");
+  CPPUNIT_ASSERT(t.nodes() == 5);
+  CPPUNIT_ASSERT(t.parent(0) == 0 && t.level(0) == 1 && t.area(0) == 7);
+
+  std::vector<uint64_t> c = components_at(t, 2);
+  CPPUNIT_ASSERT(c.size() == 1 && t.area(c[0]) == 5 && t.first(c[0]) == 1);
+  c = components_at(t, 4);
+  CPPUNIT_ASSERT(c.size() == 2 && t.area(c[0]) == 1 && t.area(c[1]) == 2);
+  CPPUNIT_ASSERT(components_at(t, 6).empty());
+
+  std::array<uint8_t,7> labels;
+  CPPUNIT_ASSERT(label_at(t, 3.5, labels.data()) == 2);
+  const std::array<uint8_t,7> expected = {{0, 1, 0, 0, 2, 2, 0}};
+  CPPUNIT_ASSERT(labels == expected);
+}
+
+// at every threshold, the tree's labels are ccom's; however many slabs
+// the build merged.
+void TreeSuite::test_ccom() {
+  srand(41);
+  for(size_t trial=0; trial < 40; ++trial) {
+    tasks::configure(1 + trial % 4, false);
+    std::array<uint64_t,3> dims;
+    for(uint64_t& d : dims) { d = 1 + rand() % 9; }
+    std::vector<uint8_t> v(dims[0]*dims[1]*dims[2]);
+    for(uint8_t& e : v) { e = rand() % 6; }
+    // signed and floating point values sort differently; the tree must not
+    // care.
+    std::vector<int8_t> sv(v.begin(), v.end());
+    std::vector<float> fv(v.begin(), v.end());
+    for(int8_t& e : sv) { e -= 3; }
+    write_tree(".stree", build_component_tree(sv.data(), dims));
+    write_tree(".ftree", build_component_tree(fv.data(), dims));
+    write_tree(".tree", build_component_tree(v.data(), dims));
+    const tree_file t(".tree"), ts(".stree"), tf(".ftree");
+
+    for(uint8_t th=0; th <= 6; ++th) {
+      const std::vector<band<uint8_t>> fg = {{th, 255, 1}};
+      std::vector<uint32_t> expected(v.size()), labels(v.size());
+      const ccom_stats st = ccom(v.data(), dims, dense_strides(dims), fg,
+                                 expected.data());
+      CPPUNIT_ASSERT(label_at(t, th, labels.data()) == st.components);
+      CPPUNIT_ASSERT(labels == expected);
+      CPPUNIT_ASSERT(label_at(ts, th-3, labels.data()) == st.components);
+      CPPUNIT_ASSERT(labels == expected);
+      CPPUNIT_ASSERT(label_at(tf, th, labels.data()) == st.components);
+      CPPUNIT_ASSERT(labels == expected);
+      const std::vector<uint64_t> c = components_at(t, th);
+      for(size_t l=0; l < c.size(); ++l) {
+        CPPUNIT_ASSERT(t.area(c[l]) == st.voxels[l+1]);
+      }
+    }
+  }
+}
+
+void TreeSuite::test_empty() {
+  const std::array<uint64_t,3> dims = {{0, 0, 0}};
+  write_tree(".tree", build_component_tree<float>(NULL, dims));
+  const tree_file t(".tree");
+  CPPUNIT_ASSERT(t.nodes() == 0 && components_at(t, 0).empty());
+}
+
+// NaN has no place in the order of levels.
+void TreeSuite::test_nan() {
+  const std::array<uint64_t,3> dims = {{2, 2, 2}};
+  std::vector<float> v(8, 1.0f);
+  v[5] = std::numeric_limits<float>::quiet_NaN();
+  CPPUNIT_ASSERT_THROW(build_component_tree(v.data(), dims),
+                       std::domain_error);
+  v[5] = 2.0f;
+  CPPUNIT_ASSERT(build_component_tree(v.data(), dims).parent.size() == 2);
+}
@@ -0,0 +1,14 @@
+#ifndef TJF_TREE_SUITE_H
+#define TJF_TREE_SUITE_H
+#include <cppunit/TestFixture.h>
+
+class TreeSuite : public CppUnit::TestFixture {
+  public:
+    virtual void tearDown();
+
+    void test_nested();
+    void test_ccom();
+    void test_empty();
+    void test_nan();
+};
+#endif /* TJF_TREE_SUITE_H */
@@ -0,0 +1,141 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "f-nrrd.h"
+#include "histogram.h"
+#include "mmap-memory.h"
+#include "tasks.h"
+#include "threshold.h"
+#include "tiff-stack.h"
+#include "volume.h"
+
+int main(int argc, char* argv[])
+{
+  // an optional region comes first; the rest is positional.
+  const char* region_spec = NULL;
+  if(argc > 1 && strncmp(argv[1], "--roi=", 6) == 0) {
+    region_spec = argv[1] + 6;
+    --argc;
+    ++argv;
+  }
+  const bool mask = argc == 7 && strcmp(argv[6], "mask") == 0;
+  if(argc != 6 && argc != 5 && !mask) {
+    std::cerr << "Usage: " << argv[0] << " [--roi=x,y,z,w,h,d[,sx,sy,sz]]"
+              << " in-nhdr out-raw out-nhdr lower-bound upper-bound [mask]\n"
+              << "       " << argv[0] << " [--roi=...]"
+              << " in-nhdr out-raw out-nhdr \"lo hi class; lo hi class; ...\"\n"
+              << "bounds may be numbers, auto:otsu or auto:pNN (percentile),\n"
+              << "optionally with /N to estimate from every Nth value.\n"
+              << "mask writes a bit-packed mask of the voxels within the "
+              << "bounds.\n"
+              << "in-nhdr may also be a multi-page TIFF or a directory of "
+              << "TIFF slices.\n"
+              << "--roi processes only the w x h x d box at x,y,z, taking "
+              << "every s'th voxel\nalong each axis if strides are given; "
+              << "the output's nhdr records where\nthe box lies.  automatic "
+              << "bounds still come from the whole input, so a\ndecimated "
+              << "preview thresholds just as the full volume does.\n";
+    return EXIT_FAILURE;
+  }
+  const bool bands = argc == 5;
+
+  // TIFF stacks are decoded as we go; anything else is a mapped nrrd.
+  std::unique_ptr<tiff_stack> stack;
+  std::array<uint64_t,3> dims;
+  std::string rawfn;
+  nrrd::dtype intype;
+  try {
+    if(is_tiff(argv[1])) {
+      stack.reset(new tiff_stack(argv[1]));
+      dims = stack->dims();
+      rawfn = argv[1];
+      intype = stack->type();
+    } else {
+      const nrrd n(argv[1]);
+      dims = n.dimensions();
+      rawfn = n.datafile();
+      intype = n.datatype();
+    }
+  } catch(const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+  if(intype == nrrd::BIT) {
+    std::cerr << "the input is a mask already\n";
+    return EXIT_FAILURE;
+  }
+  std::clog << dims[0] << "x" << dims[1] << "x" << dims[2]
+            << (stack ? " TIFF stack " : " nrrd in file ") << rawfn << "\n";
+  roi region;
+  try {
+    region = region_spec ? parse_roi(region_spec, dims) : whole_roi(dims);
+  } catch(const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+  const std::array<uint64_t,3> out = roi_dims(region);
+  const uint64_t voxels = dims[0]*dims[1]*dims[2];
+
+  std::unique_ptr<memory> raw;
+  if(!stack) {
+    raw.reset(new memory(rawfn.c_str()));
+    if(voxels > 0 && (!*raw || raw->length < voxels*nrrd::bytes(intype))) {
+      std::cerr << "Cannot open " << rawfn << "\n";
+      return EXIT_FAILURE;
+    }
+  }
+
+  try {
+    std::string spec = argv[4];
+    if(!bands) {
+      const tiff_stack* st = stack.get();
+      auto_bounds automatic = stack ?
+        auto_bounds([st](uint64_t stride) {
+          return make_histogram(*st, stride);
+        }) : auto_bounds(rawfn, intype);
+      spec = automatic(argv[4]) + " " + automatic(argv[5]);
+      std::clog << "bounds: " << spec << "\n";
+    }
+    const threshold_mode mode = bands ? THRESHOLD_BANDS :
+                                mask ? THRESHOLD_MASK : THRESHOLD_VALUES;
+    threshold(dims, intype, region, mode, spec, argv[2], argv[3],
+              [&](const slice_fn& apply) {
+      if(stack) {
+        // only the region's slices are decoded, and of those only the
+        // region's scanlines are looked at.
+        const uint64_t skip = (region.offset[1]*dims[0] + region.offset[0]) *
+                              nrrd::bytes(intype);
+        const uint64_t z0 = region.offset[2];
+        if(region.stride[2] == 1) {
+          // a few slices decode ahead of the one we threshold.
+          stack->stream(z0, z0+out[2], 2*tasks::threads(),
+                        [&](uint64_t z, const void* in) {
+            apply(static_cast<const char*>(in) + skip, z-z0, z-z0+1);
+          });
+        } else {
+          std::vector<char> slice(stack->slice_bytes());
+          for(uint64_t z=0; z < out[2]; ++z) {
+            stack->read(z0 + z*region.stride[2], z0 + z*region.stride[2]+1,
+                        slice.data());
+            apply(slice.data() + skip, z, z+1);
+          }
+        }
+      } else if(voxels > 0) {
+        // the mapping reads in the pages of the region's scanlines alone.
+        apply(static_cast<const char*>(raw->map) +
+              roi_start(region, dense_strides(dims))*nrrd::bytes(intype), 0,
+              out[2]);
+      }
+    });
+  } catch(const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -1,121 +1,103 @@
-#include <cerrno>
-#include <cstdlib>
-#include <cstring>
+#include <cstdio>
 #include <fstream>
-#include <iostream>
+#include <functional>
 #include <memory>
 #include <sstream>
 #include <stdexcept>
-#include <utility>
-#include <libgen.h>
+#include <string>
 
+#include "bitmask.h"
+#include "classify.h"
 #include "f-nrrd.h"
-
-std::string dirname_fixed(std::string);
-
-struct array_deleter {
-  template<typename T> void operator()(T* t) const { delete[] t; }
-};
-
-template<typename T> void threshold(std::istream& is, std::ostream& os,
-                                    std::string bounds)
-{
-  std::pair<T,T> bds;
-  {
-    std::istringstream b(bounds);
-    b >> bds.first >> bds.second;
-  }
-
-  T elem;
-  const T zero = static_cast<T>(0);
-  do {
-    is.read(reinterpret_cast<char*>(&elem), sizeof(T));
-    if(is.eof()) { break; }
-
-    if(!is) {
-      std::clog << "errno(" << errno << "): " << strerror(errno) << "\n";
-      throw std::runtime_error("read failed.");
+#include "mmap-memory.h"
+#include "threshold.h"
+#include "volume.h"
+
+namespace {
+  // processes a packed slab of 'dims' from 'in' into 'out'.
+  typedef std::function<void(const void* in,
+                             const std::array<uint64_t,3>& dims,
+                             void* out)> kernel;
+
+  // parses 'spec' once, up front; the kernel keeps what it parsed.
+  template<typename T> kernel make_kernel(threshold_mode mode,
+                                          std::string spec,
+                                          const std::array<uint64_t,3>& s) {
+    if(mode == THRESHOLD_BANDS) {
+      const std::shared_ptr<const classifier<T>> cls(
+        new classifier<T>(parse_bands<T>(spec))
+      );
+      return [cls, s](const void* in, const std::array<uint64_t,3>& d,
+                      void* out) {
+        classify(static_cast<const T*>(in), d, s, *cls,
+                 static_cast<uint8_t*>(out));
+      };
     }
-
-    if(bds.first <= elem && elem <= bds.second) {
-      os.write(reinterpret_cast<const char*>(&elem), sizeof(T));
-    } else {
-      os.write(reinterpret_cast<const char*>(&zero), sizeof(T));
+    std::istringstream b(spec);
+    const std::pair<T,T> r = parse_range<T>(b);
+    if(mode == THRESHOLD_MASK) {
+      return [r, s](const void* in, const std::array<uint64_t,3>& d,
+                    void* out) {
+        threshold_mask(static_cast<const T*>(in), d, s, r.first, r.second,
+                       static_cast<uint64_t*>(out));
+      };
     }
-  } while(is);
-}
-
-int main(int argc, char* argv[])
-{
-  if(argc != 6) {
-    std::cerr << "Usage: " << argv[0]
-              << " in-nhdr out-raw out-nhdr lower-bound upper-bound\n";
-    return EXIT_FAILURE;
-  }
-
-  nrrd n(argv[1]);
-
-  std::array<uint64_t,3> dims = n.dimensions();
-  std::string rawfn = n.filename();
-  std::clog << dims[0] << "x" << dims[1] << "x" << dims[2] << " nrrd in file "
-            << rawfn << "\n";
-  std::ifstream raw(rawfn.c_str(), std::ios::in | std::ios::binary);
-  if(!raw) {
-    rawfn = dirname_fixed(argv[1]) + "/" + n.filename();
-    raw.open(rawfn.c_str(), std::ios::in | std::ios::binary);
-  }
-  if(!raw) {
-    std::cerr << "Cannot open " << rawfn << "\n";
-    return EXIT_FAILURE;
+    return [r, s](const void* in, const std::array<uint64_t,3>& d,
+                  void* out) {
+      threshold(static_cast<const T*>(in), d, s, r.first, r.second,
+                static_cast<T*>(out));
+    };
   }
 
-  { // write out the header for the file we created
-    std::ofstream outhdr(argv[3], std::ios::out);
-    if(!outhdr) {
-      std::clog << "Could not open '" << argv[3] << "' to create output hdr.\n";
-      return EXIT_FAILURE;
+  kernel make_kernel(nrrd::dtype t, threshold_mode mode, std::string spec,
+                     const std::array<uint64_t,3>& s) {
+    switch(t) {
+      case nrrd:: UINT8: return make_kernel< uint8_t>(mode, spec, s);
+      case nrrd::UINT16: return make_kernel<uint16_t>(mode, spec, s);
+      case nrrd::UINT32: return make_kernel<uint32_t>(mode, spec, s);
+      case nrrd::UINT64: return make_kernel<uint64_t>(mode, spec, s);
+      case nrrd:: INT8: return make_kernel< int8_t>(mode, spec, s);
+      case nrrd::INT16: return make_kernel<int16_t>(mode, spec, s);
+      case nrrd::INT32: return make_kernel<int32_t>(mode, spec, s);
+      case nrrd::INT64: return make_kernel<int64_t>(mode, spec, s);
+      case nrrd::FLOAT: return make_kernel<float>(mode, spec, s);
+      case nrrd::DOUBLE: return make_kernel<double>(mode, spec, s);
+      case nrrd::BIT: break;
     }
-    outhdr << "NRRD0002\n"
-           << "dimension: 3\n"
-           << "sizes: " << dims[0] << " " << dims[1] << " " << dims[2] << "\n"
-           << "type: " << nrrd::type(n.datatype()) << "\n"
-           << "encoding: raw\n"
-           << "data file: " << argv[2] << "\n";
-    outhdr.close();
-  }
-
-  std::ofstream out(argv[2], std::ios::out | std::ios::binary);
-  if(!out) {
-    std::cerr << "Could not open '" << out << "'\n";
-    remove(argv[3]); // try to delete the nhdr we created.
-    return EXIT_FAILURE;
+    throw std::domain_error("the input is a mask already");
   }
-
-  std::string bounds(argv[4]);
-  bounds += std::string(" ") + argv[5];
-  switch(n.datatype()) {
-    case nrrd:: UINT8: threshold< uint8_t>(raw, out, bounds); break;
-    case nrrd::UINT16: threshold<uint16_t>(raw, out, bounds); break;
-    case nrrd::UINT32: threshold<uint32_t>(raw, out, bounds); break;
-    case nrrd::UINT64: threshold<uint64_t>(raw, out, bounds); break;
-    case nrrd:: INT8: threshold< int8_t>(raw, out, bounds); break;
-    case nrrd::INT16: threshold<int16_t>(raw, out, bounds); break;
-    case nrrd::INT32: threshold<int32_t>(raw, out, bounds); break;
-    case nrrd::INT64: threshold<int64_t>(raw, out, bounds); break;
-    case nrrd::FLOAT: threshold<float>(raw, out, bounds); break;
-    case nrrd::DOUBLE: threshold<double>(raw, out, bounds); break;
-  }
-
-  return EXIT_SUCCESS;
 }
 
-// the default 'dirname' call modifies it's argument.  ridiculous.
-// this is the same thing with useful semantics.
-std::string dirname_fixed(std::string s)
+void threshold(const std::array<uint64_t,3>& indims, nrrd::dtype intype,
+               const roi& region, threshold_mode mode, std::string spec,
+               std::string outraw, std::string outnhdr,
+               const std::function<void(const slice_fn&)>& feed)
 {
-  std::shared_ptr<char> dir(new char[s.length()+1], array_deleter());
-  s.copy(dir.get(), s.length());
-  dir.get()[s.length()] = '\0';
-
-  return std::string(dirname(dir.get()));
+  const bool bands = mode == THRESHOLD_BANDS;
+  const bool mask = mode == THRESHOLD_MASK;
+  const nrrd::dtype outtype = bands ? nrrd::UINT8 : mask ? nrrd::BIT : intype;
+
+  const std::array<uint64_t,3> dims = roi_dims(region);
+  const std::array<uint64_t,3> strides = roi_strides(region,
+                                                     dense_strides(indims));
+  // a bad spec must not leave an output behind which looks like a result.
+  const kernel k = make_kernel(intype, mode, spec, strides);
+  const uint64_t voxels = dims[0]*dims[1]*dims[2];
+  nrrd::write_header(outnhdr, dims, outtype, outraw, region);
+
+  // start from an empty file; mapping a stale, longer one would keep its tail.
+  std::ofstream(outraw.c_str(), std::ios::binary | std::ios::trunc).close();
+  if(voxels == 0) { return; }
+  // mask scanlines are padded to whole words.
+  const uint64_t slice_out = mask ? mask_bytes({{dims[0], dims[1], 1}}) :
+                                    dims[0]*dims[1]*nrrd::bytes(outtype);
+  memory out(outraw.c_str(), dims[2]*slice_out);
+  if(!out) {
+    remove(outnhdr.c_str()); // try to delete the nhdr we created.
+    throw std::runtime_error("could not open '" + outraw + "'");
+  }
+  feed([&](const void* in, uint64_t z0, uint64_t z1) {
+    const std::array<uint64_t,3> d = {{dims[0], dims[1], z1-z0}};
+    k(in, d, static_cast<char*>(out.map) + z0*slice_out);
+  });
 }
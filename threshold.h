@@ -0,0 +1,104 @@
+/* In-memory thresholding.  'in' is addressed with element strides (see
+ * volume.h); 'out' is a packed, x-fastest volume of the same size.  Rows
+ * are handed out in chunks through the task pool (tasks.h). */
+#ifndef TJF_THRESHOLD_H
+#define TJF_THRESHOLD_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "bitmask.h"
+#include "classify.h"
+#include "f-nrrd.h"
+#include "tasks.h"
+#include "volume.h"
+
+/// rows per task: enough voxels that scheduling costs nothing.
+inline uint64_t threshold_grain(const std::array<uint64_t,3>& dims) {
+  return std::max<uint64_t>(1, (1u << 16) / std::max<uint64_t>(1, dims[0]));
+}
+
+/// keeps values in [lo, hi] and zeroes everything else.
+template<typename T>
+void threshold(const T* in, const std::array<uint64_t,3>& dims,
+               const std::array<uint64_t,3>& strides, T lo, T hi, T* out)
+{
+  const T zero = static_cast<T>(0);
+  tasks::parallel_for(0, dims[1]*dims[2], threshold_grain(dims),
+                      [&](uint64_t r0, uint64_t r1) {
+    for(uint64_t r=r0; r < r1; ++r) {
+      const T* src = in + (r % dims[1])*strides[1] + (r / dims[1])*strides[2];
+      T* dst = out + r*dims[0];
+      for(uint64_t x=0; x < dims[0]; ++x) {
+        const T v = src[x*strides[0]];
+        dst[x] = (lo <= v && v <= hi) ? v : zero;
+      }
+    }
+  });
+}
+
+/// mask mode: sets the bits (see bitmask.h) of the values in [lo, hi].
+template<typename T>
+void threshold_mask(const T* in, const std::array<uint64_t,3>& dims,
+                    const std::array<uint64_t,3>& strides, T lo, T hi,
+                    uint64_t* out)
+{
+  const uint64_t words = mask_words(dims[0]);
+  tasks::parallel_for(0, dims[1]*dims[2], threshold_grain(dims),
+                      [&](uint64_t r0, uint64_t r1) {
+    std::vector<uint8_t> member(dims[0]);
+    for(uint64_t r=r0; r < r1; ++r) {
+      const T* src = in + (r % dims[1])*strides[1] + (r / dims[1])*strides[2];
+      for(uint64_t x=0; x < dims[0]; ++x) {
+        const T v = src[x*strides[0]];
+        member[x] = lo <= v && v <= hi;
+      }
+      pack_row(member.data(), dims[0], out + r*words);
+    }
+  });
+}
+
+/// multi-band mode: writes the class ID of every voxel.
+template<typename T>
+void classify(const T* in, const std::array<uint64_t,3>& dims,
+              const std::array<uint64_t,3>& strides,
+              const classifier<T>& cls, uint8_t* out)
+{
+  tasks::parallel_for(0, dims[1]*dims[2], threshold_grain(dims),
+                      [&](uint64_t r0, uint64_t r1) {
+    std::vector<T> row(strides[0] == 1 ? 0 : dims[0]);
+    for(uint64_t r=r0; r < r1; ++r) {
+      const T* src = in + (r % dims[1])*strides[1] + (r / dims[1])*strides[2];
+      if(strides[0] != 1) { // gather, so the classifier sees a packed row.
+        for(uint64_t x=0; x < dims[0]; ++x) { row[x] = src[x*strides[0]]; }
+        src = row.data();
+      }
+      cls(src, out + r*dims[0], dims[0]);
+    }
+  });
+}
+
+/// what the threshold tool writes: the values within the bounds, a mask of
+/// them, or the classes of bands.
+enum threshold_mode { THRESHOLD_VALUES, THRESHOLD_MASK, THRESHOLD_BANDS };
+
+/// 'apply(in, z0, z1)' processes slices [z0,z1) of the output; 'in' points
+/// at the input voxel of the output's voxel (0, 0, z0).
+typedef std::function<void(const void*, uint64_t, uint64_t)> slice_fn;
+
+/// file-based interface, as the threshold tool has it.  'spec' is "lo hi",
+/// both numbers, or a band list "lo hi class; ..." for THRESHOLD_BANDS.
+/// the output is 'region' (see volume.h) of an input of size 'dims', which
+/// 'apply' addresses as a packed volume: by scanlines of dims[0], slices of
+/// dims[0]*dims[1].  creates 'outraw' and its header 'outnhdr', then calls
+/// 'feed(apply)', which hands 'apply' slices of the input to cover the
+/// whole output, one call at a time.
+void threshold(const std::array<uint64_t,3>& dims, nrrd::dtype intype,
+               const roi& region, threshold_mode, std::string spec,
+               std::string outraw, std::string outnhdr,
+               const std::function<void(const slice_fn&)>& feed);
+
+#endif /* TJF_THRESHOLD_H */
@@ -0,0 +1,439 @@
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <exception>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <thread>
+#include <tiffio.h>
+#include "tasks.h"
+#include "tiff-stack.h"
+
+namespace {
+  // a TIFF handle, closed when we are done with it.
+  struct handle {
+    handle(std::string fn, const char* mode) : t(TIFFOpen(fn.c_str(), mode)) {
+      if(!t) { throw std::runtime_error("cannot open TIFF '" + fn + "'"); }
+    }
+    ~handle() { TIFFClose(this->t); }
+    handle(const handle&) = delete;
+    handle& operator=(const handle&) = delete;
+    TIFF* t;
+  };
+
+  // the size and sample type of the current page.
+  struct page {
+    uint32_t width, height;
+    nrrd::dtype type;
+  };
+
+  page describe(TIFF* t, std::string fn) {
+    page p;
+    uint16_t bits = 0, samples = 1, format = SAMPLEFORMAT_UINT;
+    if(!TIFFGetField(t, TIFFTAG_IMAGEWIDTH, &p.width) ||
+       !TIFFGetField(t, TIFFTAG_IMAGELENGTH, &p.height)) {
+      throw std::runtime_error("'" + fn + "' has a page without a size");
+    }
+    TIFFGetFieldDefaulted(t, TIFFTAG_BITSPERSAMPLE, &bits);
+    TIFFGetFieldDefaulted(t, TIFFTAG_SAMPLESPERPIXEL, &samples);
+    TIFFGetFieldDefaulted(t, TIFFTAG_SAMPLEFORMAT, &format);
+    if(samples != 1) {
+      throw std::runtime_error("'" + fn + "' has more than one channel");
+    }
+    const nrrd::dtype uints[] = {
+      nrrd::UINT8, nrrd::UINT16, nrrd::UINT32, nrrd::UINT64
+    };
+    const nrrd::dtype ints[] = {
+      nrrd::INT8, nrrd::INT16, nrrd::INT32, nrrd::INT64
+    };
+    const int b = bits == 8 ? 0 : bits == 16 ? 1 : bits == 32 ? 2 :
+                  bits == 64 ? 3 : -1;
+    if(b >= 0 && format == SAMPLEFORMAT_UINT) {
+      p.type = uints[b];
+    } else if(b >= 0 && format == SAMPLEFORMAT_INT) {
+      p.type = ints[b];
+    } else if(bits == 32 && format == SAMPLEFORMAT_IEEEFP) {
+      p.type = nrrd::FLOAT;
+    } else if(bits == 64 && format == SAMPLEFORMAT_IEEEFP) {
+      p.type = nrrd::DOUBLE;
+    } else {
+      throw std::runtime_error("'" + fn + "' has samples of an unsupported "
+                               "type");
+    }
+    return p;
+  }
+
+  // decodes the current page, 'd[0]' x 'd[1]' samples of 'bytes' bytes.
+  void read_page(TIFF* t, std::string fn, const std::array<uint64_t,3>& d,
+                 size_t bytes, char* out) {
+    const uint64_t row = d[0]*bytes;
+    if(TIFFIsTiled(t)) {
+      uint32_t tw = 0, th = 0;
+      TIFFGetField(t, TIFFTAG_TILEWIDTH, &tw);
+      TIFFGetField(t, TIFFTAG_TILELENGTH, &th);
+      if(tw == 0 || th == 0) {
+        throw std::runtime_error("'" + fn + "' has a bad tile size");
+      }
+      std::vector<char> tile(TIFFTileSize(t));
+      for(uint64_t ty=0; ty < d[1]; ty += th) {
+        for(uint64_t tx=0; tx < d[0]; tx += tw) {
+          if(TIFFReadTile(t, tile.data(), tx, ty, 0, 0) < 0) {
+            throw std::runtime_error("cannot decode '" + fn + "'");
+          }
+          const uint64_t rows = std::min<uint64_t>(th, d[1]-ty);
+          const uint64_t cols = std::min<uint64_t>(tw, d[0]-tx);
+          for(uint64_t r=0; r < rows; ++r) {
+            memcpy(out + (ty+r)*row + tx*bytes, tile.data() + r*tw*bytes,
+                   cols*bytes);
+          }
+        }
+      }
+      return;
+    }
+    uint32_t rps = 0;
+    TIFFGetFieldDefaulted(t, TIFFTAG_ROWSPERSTRIP, &rps);
+    const uint64_t per = std::max<uint64_t>(1, std::min<uint64_t>(rps, d[1]));
+    for(uint32_t s=0; s < TIFFNumberOfStrips(t) && s*per < d[1]; ++s) {
+      const uint64_t rows = std::min<uint64_t>(per, d[1] - s*per);
+      if(TIFFReadEncodedStrip(t, s, out + s*per*row, rows*row) < 0) {
+        throw std::runtime_error("cannot decode '" + fn + "'");
+      }
+    }
+  }
+
+  // the number which orders the slices of a directory: its last digits.
+  uint64_t slice_number(const std::string& name) {
+    const size_t e = name.find_last_of("0123456789");
+    if(e == std::string::npos) { return 0; }
+    size_t b = e;
+    while(b > 0 && isdigit(static_cast<unsigned char>(name[b-1]))) { --b; }
+    return std::strtoull(name.substr(b, e-b+1).c_str(), NULL, 10);
+  }
+
+  bool tiff_name(std::string name) {
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+    for(const char* ext : {".tif", ".tiff"}) {
+      const size_t n = strlen(ext);
+      if(name.size() > n && name.compare(name.size()-n, n, ext) == 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  std::vector<std::string> slices_of(std::string dir) {
+    DIR* d = opendir(dir.c_str());
+    if(!d) { throw std::runtime_error("cannot list '" + dir + "'"); }
+    std::vector<std::string> names;
+    for(const dirent* e = readdir(d); e != NULL; e = readdir(d)) {
+      if(tiff_name(e->d_name)) { names.push_back(e->d_name); }
+    }
+    closedir(d);
+    std::sort(names.begin(), names.end(),
+              [](const std::string& a, const std::string& b) {
+      const uint64_t na = slice_number(a), nb = slice_number(b);
+      return na != nb ? na < nb : a < b;
+    });
+    if(!dir.empty() && dir.back() != '/') { dir += "/"; }
+    for(std::string& n : names) { n = dir + n; }
+    return names;
+  }
+
+  bool is_directory(std::string path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+  }
+
+  // unknown tags and the like are common in microscopy data; libtiff would
+  // print a warning for each page.
+  struct quiet {
+    quiet() { TIFFSetWarningHandler(NULL); }
+  } quiet_warnings;
+}
+
+bool is_tiff(std::string path)
+{
+  if(is_directory(path)) { return true; }
+  std::ifstream ifs(path.c_str(), std::ios::binary);
+  unsigned char m[4];
+  if(!ifs.read(reinterpret_cast<char*>(m), sizeof(m))) { return false; }
+  // classic (42) or big (43) TIFF, in either byte order.
+  return (m[0] == 'I' && m[1] == 'I' && (m[2] == 42 || m[2] == 43) &&
+          m[3] == 0) ||
+         (m[0] == 'M' && m[1] == 'M' && m[2] == 0 &&
+          (m[3] == 42 || m[3] == 43));
+}
+
+// reads slices one after the other, keeping a multi-page file open.
+struct tiff_stack::cursor {
+  explicit cursor(const tiff_stack& s) : stack(s) {}
+
+  void read(uint64_t z, char* out) {
+    const std::string& fn = stack.files.empty() ? stack.path : stack.files[z];
+    std::unique_ptr<handle> single;
+    TIFF* t;
+    if(stack.files.empty()) {
+      if(!this->multi) { this->multi.reset(new handle(fn, "r")); }
+      t = this->multi->t;
+      if(!TIFFSetSubDirectory(t, stack.pages[z])) {
+        throw std::runtime_error("cannot find a page of '" + fn + "'");
+      }
+    } else {
+      single.reset(new handle(fn, "r"));
+      t = single->t;
+    }
+    const page p = describe(t, fn);
+    if(p.width != stack.dims()[0] || p.height != stack.dims()[1] ||
+       p.type != stack.type()) {
+      throw std::runtime_error("the pages of '" + stack.path + "' differ in "
+                               "size or type");
+    }
+    read_page(t, fn, stack.dims(), nrrd::bytes(stack.type()), out);
+  }
+
+  const tiff_stack& stack;
+  std::unique_ptr<handle> multi;
+};
+
+tiff_stack::tiff_stack(std::string p) : path(p)
+{
+  std::string first = p;
+  if(is_directory(p)) {
+    this->files = slices_of(p);
+    if(this->files.empty()) {
+      throw std::runtime_error("no TIFF slices in '" + p + "'");
+    }
+    first = this->files[0];
+  }
+  const handle h(first, "r");
+  const page pg = describe(h.t, first);
+  this->dims_ = {{pg.width, pg.height, this->files.size()}};
+  this->type_ = pg.type;
+  if(this->files.empty()) {
+    do {
+      this->pages.push_back(TIFFCurrentDirOffset(h.t));
+    } while(TIFFReadDirectory(h.t));
+    this->dims_[2] = this->pages.size();
+  }
+}
+
+void tiff_stack::read(uint64_t z0, uint64_t z1, void* out) const
+{
+  char* o = static_cast<char*>(out);
+  const uint64_t bytes = this->slice_bytes();
+  tasks::parallel_for(z0, z1, 1, [&](uint64_t b, uint64_t e) {
+    cursor c(*this);
+    for(uint64_t z=b; z < e; ++z) { c.read(z, o + (z-z0)*bytes); }
+  });
+}
+
+void tiff_stack::stream(uint64_t z0, uint64_t z1, size_t window,
+                        const std::function<void(uint64_t, const void*)>& f)
+  const
+{
+  if(z0 >= z1) { return; }
+  window = std::max<uint64_t>(1, std::min<uint64_t>(window, z1-z0));
+  // slice z decodes into slot (z-z0) % window, once every slice before
+  // z-window+1 has been consumed.
+  std::vector<std::vector<char>> slots(window,
+                                       std::vector<char>(this->slice_bytes()));
+  std::vector<uint64_t> holds(window, std::numeric_limits<uint64_t>::max());
+  std::mutex m;
+  std::condition_variable cv;
+  uint64_t next = z0, consumed = z0;
+  bool stop = false;
+  std::exception_ptr err;
+
+  auto decode = [&]() {
+    cursor c(*this);
+    for(;;) {
+      uint64_t z;
+      {
+        std::unique_lock<std::mutex> lk(m);
+        cv.wait(lk, [&]() {
+          return stop || next >= z1 || next < consumed + window;
+        });
+        if(stop || next >= z1) { return; }
+        z = next++;
+      }
+      try {
+        c.read(z, slots[(z-z0) % window].data());
+      } catch(...) {
+        std::lock_guard<std::mutex> lk(m);
+        if(!err) { err = std::current_exception(); }
+        stop = true;
+        cv.notify_all();
+        return;
+      }
+      std::lock_guard<std::mutex> lk(m);
+      holds[(z-z0) % window] = z;
+      cv.notify_all();
+    }
+  };
+  std::vector<std::thread> decoders;
+  auto finish = [&]() {
+    {
+      std::lock_guard<std::mutex> lk(m);
+      stop = true;
+    }
+    cv.notify_all();
+    for(std::thread& t : decoders) { t.join(); }
+  };
+  const size_t n = std::min<size_t>(window, tasks::threads());
+  for(size_t i=0; i < n; ++i) { decoders.push_back(std::thread(decode)); }
+
+  try {
+    for(uint64_t z=z0; z < z1; ++z) {
+      const size_t s = (z-z0) % window;
+      {
+        std::unique_lock<std::mutex> lk(m);
+        cv.wait(lk, [&]() { return holds[s] == z || err; });
+        if(holds[s] != z) { std::rethrow_exception(err); }
+      }
+      f(z, slots[s].data());
+      std::lock_guard<std::mutex> lk(m);
+      ++consumed;
+      cv.notify_all();
+    }
+  } catch(...) {
+    finish();
+    throw;
+  }
+  finish();
+}
+
+histogram make_histogram(const tiff_stack& s, uint64_t stride, size_t nbins)
+{
+  const uint64_t slice = s.dims()[0]*s.dims()[1];
+  const uint64_t bytes = slice == 0 ? 0 : nrrd::bytes(s.type());
+  // where slice 'z's first sample is; there is none if that is 'slice'.
+  auto first = [&](uint64_t z) {
+    const uint64_t i = z*slice;
+    return std::min(slice, (i + stride-1) / stride * stride - i);
+  };
+  // slices decode one at a time, and only if they have a sample.
+  auto each = [&](const piece_fn& f) {
+    if(slice == 0) { return; }
+    if(stride <= slice) { // every slice has one.
+      s.stream(0, s.dims()[2], 2*tasks::threads(),
+               [&](uint64_t z, const void* in) {
+        f(static_cast<const char*>(in) + first(z)*bytes, slice - first(z));
+      });
+      return;
+    }
+    std::vector<char> in(s.slice_bytes());
+    for(uint64_t z=0; z < s.dims()[2]; ++z) {
+      if(first(z) == slice) { continue; }
+      s.read(z, z+1, in.data());
+      f(in.data() + first(z)*bytes, slice - first(z));
+    }
+  };
+  return make_histogram(each, s.type(), stride, nbins);
+}
+
+namespace {
+  void write_page(TIFF* t, std::string fn, const std::array<uint64_t,3>& d,
+                  nrrd::dtype type, const char* data) {
+    const size_t bytes = nrrd::bytes(type);
+    uint16_t format = SAMPLEFORMAT_UINT;
+    switch(type) {
+      case nrrd::INT8: case nrrd::INT16: case nrrd::INT32: case nrrd::INT64:
+        format = SAMPLEFORMAT_INT; break;
+      case nrrd::FLOAT: case nrrd::DOUBLE:
+        format = SAMPLEFORMAT_IEEEFP; break;
+      default: break;
+    }
+    const uint64_t row = d[0]*bytes;
+    // strips of about 64k, which is what libtiff suggests.
+    const uint64_t per = std::max<uint64_t>(1, (1u << 16) / std::max<uint64_t>(
+                                                 1, row));
+    TIFFSetField(t, TIFFTAG_IMAGEWIDTH, uint32_t(d[0]));
+    TIFFSetField(t, TIFFTAG_IMAGELENGTH, uint32_t(d[1]));
+    TIFFSetField(t, TIFFTAG_BITSPERSAMPLE, uint16_t(8*bytes));
+    TIFFSetField(t, TIFFTAG_SAMPLESPERPIXEL, uint16_t(1));
+    TIFFSetField(t, TIFFTAG_SAMPLEFORMAT, format);
+    TIFFSetField(t, TIFFTAG_PHOTOMETRIC, uint16_t(PHOTOMETRIC_MINISBLACK));
+    TIFFSetField(t, TIFFTAG_PLANARCONFIG, uint16_t(PLANARCONFIG_CONTIG));
+    TIFFSetField(t, TIFFTAG_COMPRESSION, uint16_t(COMPRESSION_NONE));
+    TIFFSetField(t, TIFFTAG_ROWSPERSTRIP, uint32_t(per));
+    for(uint64_t y=0, s=0; y < d[1]; y += per, ++s) {
+      const uint64_t rows = std::min<uint64_t>(per, d[1]-y);
+      if(TIFFWriteEncodedStrip(t, s, const_cast<char*>(data + y*row),
+                               rows*row) < 0) {
+        throw std::runtime_error("could not write '" + fn + "'");
+      }
+    }
+    if(!TIFFWriteDirectory(t)) {
+      throw std::runtime_error("could not write '" + fn + "'");
+    }
+  }
+}
+
+struct tiff_writer::file {
+  file(std::string fn, const char* mode) : h(fn, mode) {}
+  handle h;
+};
+
+tiff_writer::tiff_writer(std::string p, const std::array<uint64_t,3>& d,
+                         nrrd::dtype t) : path(p), dims(d), type(t), next(0)
+{
+  if(dims[0] > std::numeric_limits<uint32_t>::max() ||
+     dims[1] > std::numeric_limits<uint32_t>::max()) {
+    throw std::length_error("slices too large for TIFF");
+  }
+  const uint64_t bytes = dims[0]*dims[1]*nrrd::bytes(type);
+  if(path.empty() || path.back() != '/') {
+    // classic TIFF offsets are 32 bits.
+    const bool big = bytes*dims[2] > (uint64_t(1) << 31);
+    this->out.reset(new file(path, big ? "w8" : "w"));
+    return;
+  }
+  if(mkdir(path.c_str(), 0755) != 0 && errno != EEXIST) {
+    throw std::runtime_error("cannot create '" + path + "'");
+  }
+}
+
+tiff_writer::~tiff_writer() { }
+
+void tiff_writer::write(uint64_t z0, uint64_t z1, const void* data)
+{
+  if(z0 != this->next || z1 < z0 || z1 > this->dims[2]) {
+    throw std::invalid_argument("TIFF slabs must come in order");
+  }
+  this->next = z1;
+  const char* d = static_cast<const char*>(data);
+  const uint64_t bytes = dims[0]*dims[1]*nrrd::bytes(type);
+  if(this->out) {
+    for(uint64_t z=z0; z < z1; ++z) {
+      write_page(this->out->h.t, path, dims, type, d + (z-z0)*bytes);
+    }
+    return;
+  }
+  // zero padded, so the names sort in any tool.
+  const int digits = std::max<int>(4, std::to_string(dims[2]).size());
+  tasks::parallel_for(z0, z1, 1, [&](uint64_t b, uint64_t e) {
+    for(uint64_t z=b; z < e; ++z) {
+      char name[32];
+      snprintf(name, sizeof(name), "slice%0*llu.tif", digits,
+               static_cast<unsigned long long>(z));
+      const std::string fn = path + name;
+      const handle h(fn, (bytes > (uint64_t(1) << 31)) ? "w8" : "w");
+      write_page(h.t, fn, dims, type, d + (z-z0)*bytes);
+    }
+  });
+}
+
+void write_tiff(std::string path, const std::array<uint64_t,3>& dims,
+                nrrd::dtype type, const void* data)
+{
+  tiff_writer(path, dims, type).write(0, dims[2], data);
+}
@@ -0,0 +1,91 @@
+/* TIFF stacks: volumes kept as one TIFF page per z slice, either as the pages
+ * of one (multi-page) file or as a directory of single-page files, ordered by
+ * the last number in their names.  Pages must agree in size and sample type
+ * and hold one sample per pixel; they may be stripped or tiled, and
+ * compressed in any way libtiff knows.
+ *
+ * Every decoding thread has a TIFF handle of its own, so slices decode in
+ * parallel.  The pages of a multi-page file are found once, up front; after
+ * that, any page is one seek away. */
+#ifndef TJF_TIFF_STACK_H
+#define TJF_TIFF_STACK_H
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "f-nrrd.h"
+#include "histogram.h"
+
+/// whether 'path' is a directory, or a file which starts out like a TIFF.
+bool is_tiff(std::string path);
+
+class tiff_stack {
+  public:
+    /// throws std::runtime_error if 'path' is no stack we can read.
+    explicit tiff_stack(std::string path);
+
+    const std::array<uint64_t,3>& dims() const { return this->dims_; }
+    nrrd::dtype type() const { return this->type_; }
+    uint64_t slice_bytes() const {
+      return this->dims_[0]*this->dims_[1]*nrrd::bytes(this->type_);
+    }
+
+    /// decodes slices [z0,z1) into 'out', in parallel.
+    void read(uint64_t z0, uint64_t z1, void* out) const;
+    /// calls f(z, slice) for every z in [z0,z1), in order, while the next
+    /// slices decode in the background.  at most 'window' slices are
+    /// decoded but not yet consumed, which bounds the memory we need.
+    void stream(uint64_t z0, uint64_t z1, size_t window,
+                const std::function<void(uint64_t, const void*)>& f) const;
+
+  private:
+    struct cursor;
+
+    std::string path;
+    std::vector<std::string> files; ///< the slices of a directory
+    std::vector<uint64_t> pages; ///< offsets of a multi-page file's pages
+    std::array<uint64_t,3> dims_;
+    nrrd::dtype type_;
+};
+
+/// the histogram (see histogram.h) of a whole stack, for auto_bounds.  the
+/// stack decodes a slice at a time, and slices without a sample (with a
+/// large 'stride') not at all.
+histogram make_histogram(const tiff_stack&, uint64_t stride=1,
+                         size_t nbins=4096);
+
+/// writes a TIFF stack of size 'dims' a slab of slices at a time, in order,
+/// so the volume need never be in memory all at once.  the stack is a
+/// directory of numbered slices if 'path' ends in '/'; else one multi-page
+/// file.
+class tiff_writer {
+  public:
+    tiff_writer(std::string path, const std::array<uint64_t,3>& dims,
+                nrrd::dtype);
+    ~tiff_writer();
+    tiff_writer(const tiff_writer&) = delete;
+    tiff_writer& operator=(const tiff_writer&) = delete;
+
+    /// writes slices [z0,z1) from the packed, x-fastest slab 'data'; z0 must
+    /// be where the last slab ended.  a directory's slices are written in
+    /// parallel.
+    void write(uint64_t z0, uint64_t z1, const void* data);
+
+  private:
+    struct file;
+
+    std::string path;
+    std::array<uint64_t,3> dims;
+    nrrd::dtype type;
+    std::unique_ptr<file> out; ///< the multi-page file; NULL for a directory
+    uint64_t next; ///< the slice which comes next
+};
+
+/// writes the packed, x-fastest volume 'data' as a TIFF stack, as above.
+void write_tiff(std::string path, const std::array<uint64_t,3>& dims,
+                nrrd::dtype, const void* data);
+
+#endif /* TJF_TIFF_STACK_H */
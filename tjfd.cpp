@@ -0,0 +1,162 @@
+/* A resident server for threshold and ccom.  Clients connect to a Unix
+ * domain socket and send requests, one per line, as server.h describes;
+ * every request gets one line back.  The task pool stays up between
+ * requests.
+ *
+ * Any number of clients may stay connected; whichever has a whole request
+ * line is served, one request at a time, each with the whole task pool.
+ * A client which keeps its connection open but idle holds up nobody. */
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+
+#include "server.h"
+#include "tasks.h"
+#include "volume-cache.h"
+
+namespace {
+  struct client {
+    int fd;
+    std::string buffer; // what it sent that we did not serve yet.
+    bool eof; // it sent all it will; we only owe it replies.
+  };
+
+  // serves the first request line 'c' has buffered, if any.  false if it
+  // had none.  a client which cannot take its reply is dropped later, when
+  // poll sees it hang up.
+  bool serve_one(volume_cache& cache, client& c, bool& quit) {
+    const size_t eol = c.buffer.find('\n');
+    if(eol == std::string::npos) { return false; }
+    const std::string request = c.buffer.substr(0, eol);
+    c.buffer.erase(0, eol+1);
+    std::string reply = answer(cache, request, quit);
+    std::clog << request << ": " << reply << "\n";
+    reply += '\n';
+    for(size_t done=0; done < reply.size(); ) {
+      const ssize_t n = ::write(c.fd, reply.data()+done, reply.size()-done);
+      if(n == -1 && errno == EINTR) { continue; }
+      if(n <= 0) { break; }
+      done += n;
+    }
+    return true;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  if(argc != 2 && argc != 3) {
+    std::cerr << "Usage: " << argv[0] << " socket [budget-MiB]\n"
+              << "  serves threshold and ccom requests on the Unix socket,\n"
+              << "  keeping up to budget-MiB (default 4096) of inputs in "
+              << "memory.\n";
+    return EXIT_FAILURE;
+  }
+  const uint64_t budget = (argc > 2 ? std::strtoull(argv[2], NULL, 10) :
+                                      4096) << 20;
+
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if(strlen(argv[1]) >= sizeof(addr.sun_path)) {
+    std::cerr << "socket path too long\n";
+    return EXIT_FAILURE;
+  }
+  strcpy(addr.sun_path, argv[1]);
+  // a stale socket from an earlier run goes; anything else stays put.
+  struct stat st;
+  if(lstat(argv[1], &st) == 0) {
+    if(!S_ISSOCK(st.st_mode)) {
+      std::cerr << "'" << argv[1] << "' exists and is not a socket\n";
+      return EXIT_FAILURE;
+    }
+    unlink(argv[1]);
+  }
+  const int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(sock == -1 ||
+     bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+     listen(sock, 16) != 0) {
+    std::cerr << "cannot listen on '" << argv[1] << "': " << strerror(errno)
+              << "\n";
+    return EXIT_FAILURE;
+  }
+  // a client which hangs up early must not take us down.
+  signal(SIGPIPE, SIG_IGN);
+
+  volume_cache cache(budget);
+  std::clog << "serving on " << argv[1] << " with " << tasks::threads()
+            << " threads\n";
+  bool quit = false;
+  std::vector<client> clients;
+  while(!quit) {
+    // every client with a request gets one served per round, so nobody
+    // waits on another's stream of requests.
+    bool busy = false;
+    for(size_t i=0; i < clients.size() && !quit; ++i) {
+      busy = serve_one(cache, clients[i], quit) || busy;
+    }
+    if(quit) { break; }
+    // clients which hung up go once their last whole request is served.
+    for(size_t i=clients.size(); i > 0; --i) {
+      const client& c = clients[i-1];
+      if(c.eof && c.buffer.find('\n') == std::string::npos) {
+        close(c.fd);
+        clients.erase(clients.begin() + (i-1));
+      }
+    }
+
+    std::vector<pollfd> fds(1, pollfd());
+    std::vector<size_t> polled; // the client of fds[i+1].
+    fds[0].fd = sock;
+    fds[0].events = POLLIN;
+    for(size_t i=0; i < clients.size(); ++i) {
+      if(clients[i].eof) { continue; }
+      pollfd p = pollfd();
+      p.fd = clients[i].fd;
+      p.events = POLLIN;
+      fds.push_back(p);
+      polled.push_back(i);
+    }
+    // with requests still buffered, only look for what else came in.
+    if(poll(fds.data(), fds.size(), busy ? 0 : -1) == -1) {
+      if(errno == EINTR) { continue; }
+      std::cerr << "poll: " << strerror(errno) << "\n";
+      break;
+    }
+    for(size_t i=0; i < polled.size(); ++i) {
+      if(fds[i+1].revents == 0) { continue; }
+      client& c = clients[polled[i]];
+      char chunk[4096];
+      const ssize_t n = ::read(c.fd, chunk, sizeof(chunk));
+      if(n == -1 && errno == EINTR) { continue; }
+      if(n <= 0) {
+        c.eof = true;
+        continue;
+      }
+      c.buffer.append(chunk, n);
+    }
+    if(fds[0].revents & POLLIN) {
+      const int fd = accept(sock, NULL, NULL);
+      if(fd != -1) {
+        const client c = { fd, std::string(), false };
+        clients.push_back(c);
+      } else if(errno != EINTR && errno != ECONNABORTED) {
+        std::cerr << "accept: " << strerror(errno) << "\n";
+        break;
+      }
+    }
+  }
+  for(const client& c : clients) { close(c.fd); }
+  close(sock);
+  unlink(argv[1]);
+  return quit ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,108 @@
+#include <dirent.h>
+#include <sstream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "bitmask.h"
+#include "mmap-memory.h"
+#include "tiff-stack.h"
+#include "volume-cache.h"
+
+namespace {
+  // appends what identifies the current contents of 'fn' to 'os'.
+  void stamp_file(std::ostream& os, std::string fn) {
+    struct stat st;
+    if(stat(fn.c_str(), &st) != 0) {
+      throw std::runtime_error("cannot stat '" + fn + "'");
+    }
+    os << fn << ':' << st.st_size << ':' << st.st_mtim.tv_sec << '.'
+       << st.st_mtim.tv_nsec << ';';
+  }
+
+  // when the files behind 'path' were last changed: the nhdr and its data,
+  // or a TIFF file, or a directory and every slice in it.
+  std::string stamp(std::string path) {
+    std::ostringstream os;
+    stamp_file(os, path);
+    if(DIR* d = opendir(path.c_str())) {
+      while(const dirent* e = readdir(d)) {
+        if(e->d_name[0] != '.') { stamp_file(os, path + "/" + e->d_name); }
+      }
+      closedir(d);
+    } else if(!is_tiff(path)) {
+      stamp_file(os, nrrd(path.c_str()).datafile());
+    }
+    return os.str();
+  }
+}
+
+cached_volume::cached_volume(std::string path) : path_(path), data_(NULL),
+  bytes_(0), bounds_([this](uint64_t stride) {
+    const uint64_t n = this->dims_[0]*this->dims_[1]*this->dims_[2];
+    return make_histogram(this->data_, n, this->type_, stride);
+  })
+{
+  if(is_tiff(path)) {
+    const tiff_stack stack(path);
+    this->dims_ = stack.dims();
+    this->type_ = stack.type();
+    this->bytes_ = this->dims_[2]*stack.slice_bytes();
+    this->decoded.resize(this->bytes_);
+    stack.read(0, this->dims_[2], this->decoded.data());
+    if(this->bytes_ > 0) { this->data_ = this->decoded.data(); }
+    return;
+  }
+  const nrrd n(path.c_str());
+  this->dims_ = n.dimensions();
+  this->type_ = n.datatype();
+  this->bytes_ = this->type_ == nrrd::BIT ? mask_bytes(this->dims_) :
+                 this->dims_[0]*this->dims_[1]*this->dims_[2]*
+                 nrrd::bytes(this->type_);
+  if(this->bytes_ == 0) { return; }
+  this->mem.reset(new memory(n.datafile().c_str()));
+  if(!*this->mem || this->mem->length < this->bytes_) {
+    throw std::runtime_error("cannot read '" + n.datafile() + "'");
+  }
+  // start reading it all in now, rather than on the first request's faults.
+  madvise(this->mem->base, this->mem->length, MADV_WILLNEED);
+  this->data_ = this->mem->map;
+}
+
+cached_volume::~cached_volume() { }
+
+volume_cache::volume_cache(uint64_t budget) : budget_(budget), bytes_(0) { }
+
+std::shared_ptr<cached_volume> volume_cache::get(std::string path) {
+  const std::string st = stamp(path);
+  for(auto i=this->lru.begin(); i != this->lru.end(); ++i) {
+    if(i->path != path) { continue; }
+    if(i->stamp == st) {
+      this->lru.splice(this->lru.begin(), this->lru, i);
+      return i->v;
+    }
+    this->bytes_ -= i->v->bytes();
+    this->lru.erase(i);
+    break;
+  }
+
+  const std::shared_ptr<cached_volume> v(new cached_volume(path));
+  if(v->bytes() > this->budget_) { return v; }
+  this->evict(v->bytes());
+  const entry e = { path, st, v };
+  this->lru.push_front(e);
+  this->bytes_ += v->bytes();
+  return v;
+}
+
+void volume_cache::clear() {
+  this->lru.clear();
+  this->bytes_ = 0;
+}
+
+// drops the least recently used volumes until 'room' more bytes fit.
+void volume_cache::evict(uint64_t room) {
+  while(!this->lru.empty() && this->bytes_ + room > this->budget_) {
+    this->bytes_ -= this->lru.back().v->bytes();
+    this->lru.pop_back();
+  }
+}
@@ -0,0 +1,83 @@
+/* Input volumes kept in memory between requests, for long-running processes
+ * such as tjfd.  A raw nrrd stays mapped (and is read ahead once, so later
+ * requests find it in memory); a TIFF stack is decoded once.  Volumes also
+ * keep their histograms, so automatic bounds are computed once per volume
+ * and stride.
+ *
+ * The cache holds volumes up to a budget of bytes, evicting the least
+ * recently used ones first.  A volume in use stays valid after eviction,
+ * until its last user lets go of it.  Neither class is thread safe. */
+#ifndef TJF_VOLUME_CACHE_H
+#define TJF_VOLUME_CACHE_H
+
+#include <array>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+#include "f-nrrd.h"
+#include "histogram.h"
+
+struct memory;
+
+class cached_volume {
+  public:
+    /// 'path' is an nhdr or a TIFF stack (see tiff-stack.h).  throws
+    /// std::runtime_error if it cannot be read.
+    explicit cached_volume(std::string path);
+    ~cached_volume();
+
+    const std::string& path() const { return this->path_; }
+    const std::array<uint64_t,3>& dims() const { return this->dims_; }
+    nrrd::dtype type() const { return this->type_; }
+    /// the packed, x-fastest data; NULL for an empty volume.
+    const void* data() const { return this->data_; }
+    uint64_t bytes() const { return this->bytes_; }
+    /// automatic bounds (see histogram.h) for this volume's values.
+    auto_bounds& bounds() { return this->bounds_; }
+
+  private:
+    cached_volume(const cached_volume&) = delete;
+    cached_volume& operator=(const cached_volume&) = delete;
+
+    std::string path_;
+    std::array<uint64_t,3> dims_;
+    nrrd::dtype type_;
+    std::unique_ptr<memory> mem;
+    std::vector<char> decoded;
+    const void* data_;
+    uint64_t bytes_;
+    auto_bounds bounds_;
+};
+
+class volume_cache {
+  public:
+    /// holds at most 'budget' bytes of volumes; one volume larger than that
+    /// is still loaded, but never kept.
+    explicit volume_cache(uint64_t budget);
+
+    /// the volume 'path' names.  a cached volume is reloaded if its files
+    /// changed since.
+    std::shared_ptr<cached_volume> get(std::string path);
+    /// forgets every volume.
+    void clear();
+
+    uint64_t budget() const { return this->budget_; }
+    /// bytes of volumes held right now.
+    uint64_t bytes() const { return this->bytes_; }
+    size_t size() const { return this->lru.size(); }
+
+  private:
+    struct entry {
+      std::string path;
+      std::string stamp; ///< when the volume's files were last changed
+      std::shared_ptr<cached_volume> v;
+    };
+    void evict(uint64_t room);
+
+    std::list<entry> lru; ///< the most recently used first
+    uint64_t budget_, bytes_;
+};
+
+#endif /* TJF_VOLUME_CACHE_H */
@@ -0,0 +1,88 @@
+/* Addressing of volumes in memory.  Volumes are x-fastest; an element is at
+ * x*strides[0] + y*strides[1] + z*strides[2], with strides in elements. */
+#ifndef TJF_VOLUME_H
+#define TJF_VOLUME_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/// strides of a packed volume of size 'dims'.
+inline std::array<uint64_t,3> dense_strides(const std::array<uint64_t,3>& dims)
+{
+  const std::array<uint64_t,3> s = {{1, dims[0], dims[0]*dims[1]}};
+  return s;
+}
+
+/// a region of interest: the box of 'size' voxels from 'offset' on, taking
+/// every 'stride'th voxel along each axis.  voxel i of the region is voxel
+/// offset + i*stride of the volume.
+struct roi {
+  std::array<uint64_t,3> offset, size, stride;
+};
+
+/// the region which is all of a volume of size 'dims'.
+inline roi whole_roi(const std::array<uint64_t,3>& dims) {
+  const roi r = { {{0, 0, 0}}, dims, {{1, 1, 1}} };
+  return r;
+}
+
+/// the size of what we get out of region 'r'.
+inline std::array<uint64_t,3> roi_dims(const roi& r) {
+  std::array<uint64_t,3> d;
+  for(size_t i=0; i < 3; ++i) {
+    d[i] = (r.size[i] + r.stride[i]-1) / r.stride[i];
+  }
+  return d;
+}
+
+/// strides of region 'r' of a volume addressed with 'strides'.
+inline std::array<uint64_t,3> roi_strides(const roi& r,
+                                          const std::array<uint64_t,3>& strides)
+{
+  const std::array<uint64_t,3> s = {{
+    strides[0]*r.stride[0], strides[1]*r.stride[1], strides[2]*r.stride[2]
+  }};
+  return s;
+}
+
+/// where, in elements, the first voxel of region 'r' is.
+inline uint64_t roi_start(const roi& r, const std::array<uint64_t,3>& strides)
+{
+  return r.offset[0]*strides[0] + r.offset[1]*strides[1] +
+         r.offset[2]*strides[2];
+}
+
+/// parses "x y z  w h d  [sx sy sz]" (commas work as well as spaces) into a
+/// region of a volume of size 'dims'; throws std::invalid_argument unless it
+/// is a non-empty box within the volume.
+inline roi parse_roi(std::string spec, const std::array<uint64_t,3>& dims) {
+  std::replace(spec.begin(), spec.end(), ',', ' ');
+  std::istringstream is(spec);
+  roi r = whole_roi(dims);
+  const bool box = static_cast<bool>(is >> r.offset[0] >> r.offset[1]
+                                        >> r.offset[2] >> r.size[0]
+                                        >> r.size[1] >> r.size[2]);
+  std::vector<uint64_t> stride;
+  uint64_t s;
+  while(is >> s) { stride.push_back(s); }
+  if(!box || !is.eof() || (stride.size() != 0 && stride.size() != 3)) {
+    throw std::invalid_argument("a region is \"x y z w h d [sx sy sz]\", "
+                                "not '" + spec + "'");
+  }
+  std::copy(stride.begin(), stride.end(), r.stride.begin());
+  for(size_t i=0; i < 3; ++i) {
+    if(r.size[i] == 0 || r.stride[i] == 0 ||
+       r.offset[i] > dims[i] || r.size[i] > dims[i] - r.offset[i]) {
+      throw std::invalid_argument("region '" + spec + "' is empty or not "
+                                  "within the volume");
+    }
+  }
+  return r;
+}
+
+#endif /* TJF_VOLUME_H */